@@ -6,66 +6,155 @@
 
 // Include our modular headers
 #include "config.h"
+#include "clock.h"
+#include "events.h"
 #include "pacer.h"
 #include "led_control.h"
+#include "sync.h"
+#include "session_store.h"
+#include "session_log.h"
+#include "beacon.h"
+#include "sacn.h"
+#include "power.h"
 #include "web_page.h"
+#include "request_server.h"
 #include "web_server.h"
 
 // Global Variables
-WebServer server(80);
+RequestServer server(80);
 Preferences preferences;
 
 Pacer pacers[MAX_PACERS];
-CRGB leds[MAX_LOGICAL_LEDS];
+PacerHot pacerHot;
+LapEventRing lapEvents;
+Lane lanes[NUM_LANES];
+CRGB leds[NUM_LANES][MAX_LOGICAL_LEDS];
+CRGB ledOut[NUM_LANES][MAX_LOGICAL_LEDS];
 int current_NUM_LEDS = LOGICAL_UNITS_PER_SEGMENT; // Starts at 50
 int TOTAL_SEGMENTS = 1; // Default: 1 segment (5 meters total)
 
 bool systemRunning = false;
+clock_us_t sessionStartTime = 0;
 unsigned long lastStatusUpdate = 0;
 int connectedClients = 0;
 
+volatile bool networkReady = false;
+clock_us_t firstFrameTime = 0;  // Boot to first frame on the strip
+
+// Bring up WiFi and the web server on the network core, so a resumed session
+// is already pacing while the access point starts
+void networkTask(void *param) {
+  if (SYNC_ROLE == SYNC_ROLE_FOLLOWER) {
+    // Followers join the leader's network and take their state from it
+    WiFi.begin(AP_SSID, AP_PASSWORD);
+    Serial.print("Following leader on: ");
+    Serial.println(AP_SSID);
+  } else {
+    WiFi.softAP(AP_SSID, AP_PASSWORD, 1, 0, MAX_CLIENTS);
+    IPAddress IP = WiFi.softAPIP();
+
+    Serial.print("Connect to: ");
+    Serial.println(AP_SSID);
+    Serial.print("Go to: http://");
+    Serial.println(IP);
+  }
+  beginSync();
+  beginBeacon();
+  beginSacn();
+  server.begin();
+
+  networkReady = true;
+  vTaskDelete(NULL);
+}
+
 void setup() {
   Serial.begin(115200);
 
-  preferences.begin("trackpacer", false);
+  preferences.begin(PREFS_NAMESPACE, false);
+  loadCalibration();
+  loadLanes();
 
-  FastLED.addLeds<WS2811, LED_PIN, RBG>(leds, MAX_LOGICAL_LEDS);
+  addLaneOutputs();
   FastLED.setBrightness(255);
-  FastLED.clear();
-  FastLED.show();
+  beginOutput();
+  buildBackground();
 
   for (int i = 0; i < MAX_PACERS; i++) {
     pacers[i].enabled = false;
-    pacers[i].currentPosition = 0;
-    pacers[i].lastUpdate = 0;
+    pacers[i].lane = 0;
+    pacers[i].trailUnits = 0;
+    pacers[i].bodyUnits = LEDS_PER_SEGMENT;
+    pacers[i].profile.spec.count = 0;
+    pacers[i].startTime = 0;
   }
+  activatePacers(true);
 
-  WiFi.softAP(AP_SSID, AP_PASSWORD);
-  IPAddress IP = WiFi.softAPIP();
+  // Resume an interrupted session before anything slow happens
+  if (restoreSession()) {
+    updatePacers();
+    renderLEDs();
+  }
+  submitFrame();
+  waitFrameShown();
+  firstFrameTime = clockMicros();
+
+  Serial.print("First frame after ");
+  Serial.print((unsigned long)(firstFrameTime / CLOCK_US_PER_MS));
+  Serial.println(" ms");
 
-  Serial.print("Connect to: ");
-  Serial.println(AP_SSID);
-  Serial.print("Go to: http://");
-  Serial.println(IP);
+  beginLog();
+
+  const char *statusHeaders[] = {"If-None-Match"};
+  server.collectHeaders(statusHeaders, 1);
 
   server.on("/", HTTP_GET, handleRoot);
   server.on("/command", HTTP_POST, handleCommand);
   server.on("/segments", HTTP_POST, handleSegments);
+  server.on("/calibration", HTTP_GET, handleGetCalibration);
+  server.on("/calibration", HTTP_POST, handleSetCalibration);
+  server.on("/lanes", HTTP_GET, handleGetLanes);
+  server.on("/lanes", HTTP_POST, handleSetLane);
   server.on("/status", HTTP_GET, handleStatus);
-  server.on("/preset/save", HTTP_POST, handleSavePreset);
+  server.on("/events", HTTP_GET, handleEvents);
+  server.on("/time", HTTP_GET, handleTime);
+  server.on("/log.csv", HTTP_GET, handleExportLog);
+  server.on("/log/clear", HTTP_POST, handleClearLog);
+  server.on("/ghost/save", HTTP_POST, handleSaveGhost);
+  server.on("/ghost/load", HTTP_GET, handleLoadGhost);
+  server.on("/ghost/list", HTTP_GET, handleListGhosts);
+  server.on("/preset/save", HTTP_POST, handleSavePreset, handlePresetUpload);
   server.on("/preset/load", HTTP_GET, handleLoadPreset);
   server.on("/preset/list", HTTP_GET, handleListPresets);
   server.on("/preset/delete", HTTP_POST, handleDeletePreset);
-  server.begin();
+  server.on("/presets/export", HTTP_GET, handleExportPresets);
+  server.on("/presets/import", HTTP_POST, handleImportPresets, handleLibraryUpload);
+
+  xTaskCreatePinnedToCore(networkTask, "network", 4096, NULL, 1, NULL, 0);
 }
 
 void loop() {
-  server.handleClient();
-  connectedClients = WiFi.softAPgetStationNum();
+  if (networkReady) {
+    server.handleClient();
+    endRequest();
+    if (stationPollDue()) connectedClients = WiFi.softAPgetStationNum();
+    handleSync();
+  }
 
   if (systemRunning) {
+    wakeFromIdle();
+    waitForScheduledStart();
     updatePacers();
     renderLEDs();
-    FastLED.show();
+    checkpointSession(trackMicros());
   }
+  if (showFrame()) {
+    noteFrameShown();
+    if (networkReady) {
+      sendSacn();
+      sendBeacon();
+    }
+  }
+  logLapEvents();
+
+  if (!systemRunning) idleWait();
 }
@@ -0,0 +1,211 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Request arena
+// Web handlers hold request text and build responses in one fixed buffer
+// that is reset after every request, instead of in heap Strings, so a long
+// practice with many phones polling cannot fragment the heap. Request
+// arguments are copied into the arena once and then taken apart with
+// StrView (a pointer and a length into it) rather than substring().
+// Responses are written with TextWriter and sent straight from the buffer.
+//
+// Allocation bumps a pointer; nothing is freed individually. The loop calls
+// endRequest() after every server.handleClient(), which records the high
+// water mark and resets the arena.
+
+// Read-only view of part of a string; not null-terminated
+struct StrView {
+  const char *ptr;
+  int len;
+
+  int indexOf(char c, int from = 0) const {
+    for (int i = from; i < len; i++) {
+      if (ptr[i] == c) return i;
+    }
+    return -1;
+  }
+
+  int indexOf(const char *text, int from = 0) const {
+    int n = strlen(text);
+    for (int i = from; i + n <= len; i++) {
+      if (memcmp(ptr + i, text, n) == 0) return i;
+    }
+    return -1;
+  }
+
+  // Characters [from, to), clamped to the view
+  StrView sub(int from, int to) const {
+    if (to > len) to = len;
+    if (from < 0) from = 0;
+    if (from > to) from = to;
+    return StrView{ptr + from, to - from};
+  }
+
+  StrView sub(int from) const {
+    return sub(from, len);
+  }
+
+  bool startsWith(const char *prefix) const {
+    int n = strlen(prefix);
+    return n <= len && memcmp(ptr, prefix, n) == 0;
+  }
+
+  bool equals(const char *text) const {
+    return (int)strlen(text) == len && memcmp(ptr, text, len) == 0;
+  }
+
+  // Copy into buf (at most size - 1 characters) and terminate it
+  void copyTo(char *buf, int size) const {
+    int n = len < size - 1 ? len : size - 1;
+    memcpy(buf, ptr, n);
+    buf[n] = '\0';
+  }
+
+  // Numbers parse like String::toInt()/toFloat(): leading number, else 0
+  long toInt() const {
+    char buf[24];
+    copyTo(buf, sizeof(buf));
+    return strtol(buf, NULL, 10);
+  }
+
+  uint64_t toU64() const {
+    char buf[24];
+    copyTo(buf, sizeof(buf));
+    return strtoull(buf, NULL, 10);
+  }
+
+  float toFloat() const {
+    char buf[32];
+    copyTo(buf, sizeof(buf));
+    return strtod(buf, NULL);
+  }
+};
+
+inline StrView strView(const char *text) {
+  return StrView{text, (int)strlen(text)};
+}
+
+// Appends text to a fixed buffer, keeping it null-terminated. Output that
+// does not fit sets overflow and is dropped.
+struct TextWriter {
+  char *buf;
+  size_t len;
+  size_t cap;
+  bool overflow;
+
+  void append(const char *text, size_t n) {
+    if (overflow || len + n >= cap) {
+      overflow = true;
+      return;
+    }
+    memcpy(buf + len, text, n);
+    len += n;
+    buf[len] = '\0';
+  }
+
+  TextWriter& operator+=(const char *text) { append(text, strlen(text)); return *this; }
+  TextWriter& operator+=(StrView text) { append(text.ptr, text.len); return *this; }
+  TextWriter& operator+=(char c) { append(&c, 1); return *this; }
+  TextWriter& operator+=(int n) { return *this += (long long)n; }
+  TextWriter& operator+=(unsigned n) { return *this += (unsigned long long)n; }
+  TextWriter& operator+=(long n) { return *this += (long long)n; }
+  TextWriter& operator+=(unsigned long n) { return *this += (unsigned long long)n; }
+
+  TextWriter& operator+=(long long n) {
+    char num[24];
+    append(num, snprintf(num, sizeof(num), "%lld", n));
+    return *this;
+  }
+
+  TextWriter& operator+=(unsigned long long n) {
+    char num[24];
+    append(num, snprintf(num, sizeof(num), "%llu", n));
+    return *this;
+  }
+
+  // Fixed-point number, like String(value, digits)
+  void appendFixed(double value, int digits) {
+    char num[32];
+    append(num, snprintf(num, sizeof(num), "%.*f", digits, value));
+  }
+
+  // A JSON string literal, quoted and escaped
+  void appendQuoted(const char *text) {
+    *this += '"';
+    for (; *text; text++) {
+      uint8_t c = *text;
+      if (c == '"' || c == '\\') {
+        *this += '\\';
+        *this += (char)c;
+      } else if (c < 0x20) {
+        char esc[8];
+        append(esc, snprintf(esc, sizeof(esc), "\\u%04x", c));
+      } else {
+        *this += (char)c;
+      }
+    }
+    *this += '"';
+  }
+};
+
+inline TextWriter textWriter(char *buf, size_t cap) {
+  buf[0] = '\0';
+  return TextWriter{buf, 0, cap, false};
+}
+
+char requestArena[REQUEST_ARENA_SIZE];
+size_t arenaUsed = 0;
+size_t arenaPeak = 0;          // Most arena used by any request
+uint32_t arenaOverflows = 0;   // Requests that ran out of arena
+
+// Allocate n bytes, 4-byte aligned; NULL when the arena is full
+void* arenaAlloc(size_t n) {
+  size_t start = (arenaUsed + 3) & ~(size_t)3;
+  if (start + n > REQUEST_ARENA_SIZE) {
+    arenaOverflows++;
+    return NULL;
+  }
+  arenaUsed = start + n;
+  return requestArena + start;
+}
+
+// Copy text into the arena; an empty view if it does not fit
+StrView arenaCopy(const char *text, int len) {
+  char *copy = (char*)arenaAlloc(len + 1);
+  if (!copy) return StrView{"", 0};
+  memcpy(copy, text, len);
+  copy[len] = '\0';
+  return StrView{copy, len};
+}
+
+// Writer over the rest of the arena. Only one may be open at a time; close
+// it with arenaClose() before allocating again.
+TextWriter arenaWriter() {
+  size_t start = (arenaUsed + 3) & ~(size_t)3;
+  if (start + 1 >= REQUEST_ARENA_SIZE) start = REQUEST_ARENA_SIZE - 1;
+  return textWriter(requestArena + start, REQUEST_ARENA_SIZE - start);
+}
+
+void arenaClose(const TextWriter &writer) {
+  if (writer.overflow) arenaOverflows++;
+  arenaUsed = (writer.buf - requestArena) + writer.len + 1;
+}
+
+// Hand back everything allocated since mark (an earlier arenaUsed), for
+// handlers that reuse the same space for each chunk of a long response; the
+// high water mark still counts it
+void arenaRelease(size_t mark) {
+  if (arenaUsed > arenaPeak) arenaPeak = arenaUsed;
+  arenaUsed = mark;
+}
+
+// Record the request's arena use and reset the arena for the next one
+void endRequest() {
+  if (arenaUsed > arenaPeak) arenaPeak = arenaUsed;
+  arenaUsed = 0;
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef BEACON_H
+#define BEACON_H
+
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include "config.h"
+#include "clock.h"
+#include "pacer.h"
+
+// Position beacon
+// Scoreboards and visualizers can follow the pacers without polling the web
+// server: every frame pushed to the strip is also sent as one fixed-layout
+// UDP packet (little-endian, no padding) to the access point's broadcast
+// address or to a multicast group. The packet is filled in place in a
+// static buffer, so sending allocates nothing.
+
+#define BEACON_MAGIC 0x4E434250  // "PBCN"
+
+struct __attribute__((packed)) BeaconPacer {
+  uint8_t enabled;
+  uint8_t lane;
+  uint16_t phase;          // Fraction of the lap covered, Q16
+  uint8_t r, g, b;
+  uint32_t lap;            // Finish-line crossings since start
+};
+
+struct __attribute__((packed)) BeaconPacket {
+  uint32_t magic;
+  uint32_t seq;            // Consecutive; gaps are lost packets
+  uint64_t trackTime;      // Track clock when the packet was sent, microseconds
+  uint64_t sessionStart;
+  float trackMeters;
+  uint8_t running;
+  BeaconPacer pacers[MAX_PACERS];
+};
+
+extern bool systemRunning;
+extern clock_us_t sessionStartTime;
+
+WiFiUDP beaconUdp;
+BeaconPacket beaconPacket;
+
+void beginBeacon() {
+  if (!BEACON_ENABLED) return;
+  beaconUdp.begin(BEACON_PORT);
+}
+
+// Send the state of the frame just pushed
+void sendBeacon() {
+  if (!BEACON_ENABLED) return;
+
+  beaconPacket.magic = BEACON_MAGIC;
+  beaconPacket.seq++;
+  beaconPacket.sessionStart = sessionStartTime;
+  beaconPacket.trackMeters = trackMeters;
+  beaconPacket.running = systemRunning;
+
+  for (int i = 0; i < MAX_PACERS; i++) {
+    int slot = pacerHot.slotOf[i];
+    BeaconPacer &p = beaconPacket.pacers[i];
+
+    p.enabled = slot >= 0;
+    p.lane = pacers[i].lane;
+    p.phase = slot >= 0 ? pacerHot.phase[slot] : 0;
+    p.r = pacers[i].color.r;
+    p.g = pacers[i].color.g;
+    p.b = pacers[i].color.b;
+    p.lap = slot >= 0 ? pacerHot.lapCount[slot] : 0;
+  }
+
+#if BEACON_MULTICAST
+  beaconUdp.beginPacket(IPAddress(BEACON_GROUP), BEACON_PORT);
+#else
+  beaconUdp.beginPacket(WiFi.softAPBroadcastIP(), BEACON_PORT);
+#endif
+  beaconPacket.trackTime = trackMicros();  // Stamp as late as possible
+  beaconUdp.write((const uint8_t*)&beaconPacket, sizeof(beaconPacket));
+  beaconUdp.endPacket();
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <Preferences.h>
+#include "config.h"
+
+// Physical track calibration
+// Nominally every segment is 5 meters of track. Real installs have longer or
+// shorter strips on curves, splices and gaps, so the measured length of each
+// segment can be stored. The table is compiled into a dense lookup from lap
+// phase (fraction of the physical lap) to logical unit, so pacers move at a
+// constant speed over the ground and rendering never divides per pixel.
+//
+// Lap phase is Q16 (65536 = one lap). The top CAL_LUT_BITS bits select a
+// table entry and the remaining bits interpolate to the next one. Entries
+// are logical unit positions in 1/16 units (80 segments * 50 units * 16 fits
+// in 16 bits).
+
+#define CAL_LUT_SIZE (1 << CAL_LUT_BITS)
+#define CAL_FRAC_BITS (16 - CAL_LUT_BITS)
+
+extern Preferences preferences;
+extern int TOTAL_SEGMENTS;
+
+float segmentMeters[MAX_SEGMENTS];   // Whole millimetres; see segmentLength()
+float trackMeters = 5.0;
+uint16_t calLut[CAL_LUT_SIZE + 1];
+
+// A segment length kept to the millimetre, the precision it is sent to
+// followers with, so every controller maps the lap identically
+float segmentLength(float meters) {
+  return roundf(meters * 1000) / 1000.0f;
+}
+
+uint16_t segmentMillimeters(float meters) {
+  return (uint16_t)lroundf(meters * 1000);
+}
+
+// Rebuild the lookup table for the current segment count
+void buildCalibration() {
+  trackMeters = 0;
+  for (int k = 0; k < TOTAL_SEGMENTS; k++) {
+    trackMeters += segmentMeters[k];
+  }
+
+  int segment = 0;
+  float segmentStart = 0;
+
+  for (int i = 0; i <= CAL_LUT_SIZE; i++) {
+    float meters = trackMeters * i / CAL_LUT_SIZE;
+
+    while (segment < TOTAL_SEGMENTS - 1 && meters >= segmentStart + segmentMeters[segment]) {
+      segmentStart += segmentMeters[segment];
+      segment++;
+    }
+
+    float within = (meters - segmentStart) / segmentMeters[segment];
+    if (within > 1.0) within = 1.0;
+
+    float units = (segment + within) * LOGICAL_UNITS_PER_SEGMENT;
+    calLut[i] = (uint16_t)(units * 16 + 0.5);
+  }
+}
+
+// Map a Q16 lap phase to a logical unit position in 1/16 units
+inline uint32_t phaseToUnits16(uint32_t phase) {
+  uint32_t index = phase >> CAL_FRAC_BITS;
+  uint32_t frac = phase & ((1 << CAL_FRAC_BITS) - 1);
+  uint32_t a = calLut[index];
+  uint32_t b = calLut[index + 1];
+
+  return a + (((b - a) * frac) >> CAL_FRAC_BITS);
+}
+
+// Map a physical distance from the finish line to a Q16 lap phase, for a
+// lap of lapMeters (a negative distance counts back from the line)
+uint32_t metersToPhase(float meters, float lapMeters) {
+  float lapFraction = fmod(meters, lapMeters) / lapMeters;
+  if (lapFraction < 0) lapFraction += 1;
+  return (uint32_t)(lapFraction * 65536) & 0xFFFF;
+}
+
+// Load the measured segment lengths (5 meters where none were stored)
+void loadCalibration() {
+  for (int k = 0; k < MAX_SEGMENTS; k++) {
+    segmentMeters[k] = 5.0;
+  }
+  preferences.getBytes("calibration", segmentMeters, sizeof(segmentMeters));
+  for (int k = 0; k < MAX_SEGMENTS; k++) {
+    segmentMeters[k] = segmentLength(segmentMeters[k]);
+  }
+  buildCalibration();
+}
+
+void saveCalibration() {
+  preferences.putBytes("calibration", segmentMeters, sizeof(segmentMeters));
+}
+
+#endif
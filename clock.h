@@ -0,0 +1,126 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+// Pacing clock
+// Everything that reads time goes through clockMicros(), which returns a
+// 64-bit monotonic microsecond count that never rolls over in practice.
+// On the ESP32 it is backed by the same hardware timer as micros(); on a host
+// build it is a virtual clock that can be stepped exactly or run faster than
+// real time, so long sessions can be simulated in seconds.
+
+typedef uint64_t clock_us_t;
+
+#define CLOCK_US_PER_MS 1000ULL
+#define CLOCK_US_PER_SEC 1000000ULL
+
+#if defined(ESP32)
+#include <esp_timer.h>
+
+clock_us_t clockMicros() {
+  return (clock_us_t)esp_timer_get_time();
+}
+
+#elif defined(ARDUINO)
+#include <Arduino.h>
+
+// Widen the 32-bit micros() counter (wraps every ~71.6 minutes).
+// loop() calls this every pass, so no wrap is ever missed.
+clock_us_t clockMicros() {
+  static uint32_t lastRaw = 0;
+  static uint32_t wraps = 0;
+
+  uint32_t raw = micros();
+  if (raw < lastRaw) wraps++;
+  lastRaw = raw;
+
+  return ((clock_us_t)wraps << 32) | raw;
+}
+
+#else
+#include <chrono>
+
+// Host virtual clock
+// Stepped mode (the default): time only moves when clockStep() is called.
+// Scaled mode: time follows the host's steady clock multiplied by scale,
+// e.g. clockSetScale(1000.0) runs a 2-hour session in 7.2 seconds.
+struct VirtualClock {
+  bool stepped;
+  double scale;
+  clock_us_t anchorVirtual;
+  std::chrono::steady_clock::time_point anchorReal;
+};
+
+VirtualClock virtualClock = { true, 1.0, 0, std::chrono::steady_clock::now() };
+
+clock_us_t clockMicros() {
+  if (virtualClock.stepped) return virtualClock.anchorVirtual;
+
+  auto realElapsed = std::chrono::steady_clock::now() - virtualClock.anchorReal;
+  double realUs = (double)std::chrono::duration_cast<std::chrono::microseconds>(realElapsed).count();
+  return virtualClock.anchorVirtual + (clock_us_t)(realUs * virtualClock.scale);
+}
+
+// Jump the virtual clock to an absolute time (e.g. just before a rollover)
+void clockSet(clock_us_t us) {
+  virtualClock.anchorVirtual = us;
+  virtualClock.anchorReal = std::chrono::steady_clock::now();
+}
+
+// Advance a stepped clock by exactly us microseconds
+void clockStep(clock_us_t us) {
+  clockSet(clockMicros() + us);
+}
+
+// Switch to free-running mode at scale times real time (0 = stepped mode)
+void clockSetScale(double scale) {
+  clockSet(clockMicros());
+  virtualClock.stepped = (scale <= 0);
+  virtualClock.scale = scale;
+}
+
+#endif
+
+// Track clock
+// The timebase pacer positions are computed in. On a standalone controller or
+// a sync leader it is the local clock; a sync follower sets trackClockOffset
+// so that its track clock agrees with the leader's.
+int64_t trackClockOffset = 0;
+
+// A follower that is ahead pulls its offset back gradually instead, so the
+// track clock never runs backwards: trackClockSlewUs comes off the offset at
+// trackClockSlewPpm of local time from trackClockSlewFrom
+int64_t trackClockSlewUs = 0;
+uint32_t trackClockSlewPpm = 0;
+clock_us_t trackClockSlewFrom = 0;
+
+// How much of the slew has been taken off by local time now
+int64_t trackClockSlewed(clock_us_t now) {
+  if (trackClockSlewUs == 0) return 0;
+  int64_t done = (int64_t)((now - trackClockSlewFrom) * trackClockSlewPpm / 1000000);
+  return done < trackClockSlewUs ? done : trackClockSlewUs;
+}
+
+clock_us_t trackMicros() {
+  clock_us_t now = clockMicros();
+  return now + trackClockOffset - trackClockSlewed(now);
+}
+
+// Replace the offset outright, ending any slew
+void setTrackClockOffset(int64_t offset) {
+  trackClockOffset = offset;
+  trackClockSlewUs = 0;
+}
+
+// Take us off the offset at ppm from now, on top of what an unfinished slew
+// has already taken off
+void slewTrackClock(int64_t us, uint32_t ppm) {
+  clock_us_t now = clockMicros();
+  trackClockOffset -= trackClockSlewed(now);
+  trackClockSlewUs = us;
+  trackClockSlewPpm = ppm;
+  trackClockSlewFrom = now;
+}
+
+#endif
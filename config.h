@@ -1,23 +1,142 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+// Settings wrapped in #ifndef may also be given as build flags
+// (e.g. -DNUM_LANES=4), as the host build in host/ does
+
 // WiFi Settings
 const char* AP_SSID = "TrackPacer";
 const char* AP_PASSWORD = "pacer2024";
+#define MAX_CLIENTS 10               // Stations the access point admits (ESP32 limit)
+
+// Poll rate limits (/status, /events), in requests per second
+#define POLL_CLIENT_RATE 4           // Per client
+#define POLL_CLIENT_BURST 8
+#define POLL_TOTAL_RATE 40           // All clients together
+#define POLL_TOTAL_BURST 40
 
 // LED Configuration
 // Hardware: 24V WS2811 LED strips with 5V data input
 // Power: 24V AC adapter with step-down converter to 5V for ESP32
 #define LED_PIN 12
 
+// Lanes: one strip per lane, lane 1 on LED_PIN
+#ifndef NUM_LANES
+#define NUM_LANES 1                   // Lanes wired to this controller (1 to 8)
+#endif
+#define LANE2_PIN 13
+#define LANE3_PIN 14
+#define LANE4_PIN 27
+#define LANE5_PIN 26
+#define LANE6_PIN 25
+#define LANE7_PIN 33
+#define LANE8_PIN 32
+
 // --- Scalable Configuration ---
 #define LOGICAL_UNITS_PER_SEGMENT 50  // 50 chips per 5-meter segment
-#define LEDS_PER_SEGMENT 20            // Length of the pacer in logical units (5 chips long)
+#define LEDS_PER_SEGMENT 20            // Default length of a pacer in logical units (5 chips long)
 
 // Pacer Configuration
+#ifndef MAX_PACERS
 #define MAX_PACERS 3
+#endif
+#define MAX_TRAIL_UNITS 200            // Longest comet trail (20m)
+#define MAX_BODY_UNITS 100             // Longest pacer (10m)
 
 // Maximum possible segments (e.g., 80 segments * 50 units = 4000, but we cap at 500 for memory)
+#define MAX_SEGMENTS 80
 #define MAX_LOGICAL_LEDS 500
 
+// Calibration lookup table resolution (2^bits entries per lap)
+#define CAL_LUT_BITS 12
+
+// Scheduled start
+#define MAX_START_DELAY_MS 60000     // Furthest ahead a START_AT may be scheduled
+#define MAX_START_LATE_MS 1000       // Furthest in the past a START_AT may be (request latency)
+#define START_SPIN_WINDOW_US 20000   // Busy-wait the final stretch so release lands on time
+
+// Multi-controller sync
+// A standalone controller drives the whole track. For tracks longer than one
+// strip, one leader runs the access point and web interface and each follower
+// joins it and drives the segments starting at NODE_FIRST_SEGMENT.
+#define SYNC_ROLE_STANDALONE 0
+#define SYNC_ROLE_LEADER 1
+#define SYNC_ROLE_FOLLOWER 2
+
+#ifndef SYNC_ROLE
+#define SYNC_ROLE SYNC_ROLE_STANDALONE
+#endif
+#ifndef NODE_FIRST_SEGMENT
+#define NODE_FIRST_SEGMENT 0         // First global segment wired to this controller
+#endif
+#define SYNC_PORT 4210
+#define SYNC_INTERVAL_MS 50          // Leader broadcast period
+#define SYNC_OFFSET_WINDOW 16        // Follower clock-offset filter length (packets)
+#define SYNC_MAX_SLEW_PPM 1000       // Fastest a follower pulls its track clock back
+#define SYNC_STEP_US 100000          // Offset error a follower jumps rather than slews
+
+// Position beacon for external displays: one UDP packet per frame shown
+#ifndef BEACON_ENABLED
+#define BEACON_ENABLED 0
+#endif
+#define BEACON_PORT 4211
+#define BEACON_MULTICAST 0           // 0 = broadcast on the access point network
+#define BEACON_GROUP 239, 80, 65, 67 // Multicast group when BEACON_MULTICAST is 1
+
+// E1.31 (sACN) pixel output to network pixel controllers
+#ifndef SACN_ENABLED
+#define SACN_ENABLED 0
+#endif
+#define SACN_FIRST_UNIVERSE 1        // Universe of lane 1's first 170 pixels
+
+// Steps in a variable-pace profile (also the most splits a ghost can have)
+#define MAX_PROFILE_STEPS 32
+
+// Ghost pacers replaying recorded splits
+#define MAX_GHOSTS 8
+#define GHOST_NAME_LEN 16
+
+// Lap events kept for /events clients (power of two)
+#define EVENT_RING_SIZE 64
+
+// Web handlers build requests and responses in a fixed arena (see arena.h)
+#define REQUEST_ARENA_SIZE 8192
+#define STATUS_JSON_SIZE 1024
+
+// Streaming JSON parser limits (see json_stream.h)
+#define JSON_MAX_DEPTH 8
+#define JSON_MAX_TOKEN 64            // Longest key or value, including the terminator
+
+// NVS namespace every saved setting lives in
+#define PREFS_NAMESPACE "trackpacer"
+
+// Saved presets
+#define MAX_PRESETS 20
+#define PRESET_NAME_LEN 24
+
+// Session log on the flash filesystem
+#define LOG_PAGE_SIZE 256            // Staging buffer, written to flash when full
+#define LOG_MAX_BYTES 262144         // Log size at which a new log is started
+
+// Track markings lit dimly under the pacers (see buildBackground)
+#define TRACK_MARKINGS 1
+#define MARKER_SPACING_M 100         // Distance markers every 100 m from the finish
+#define MARKER_UNITS 2               // Width of a line or marker
+#define EXCHANGE_ZONE_BEFORE_M 20    // Relay exchange zone around each marker
+#define EXCHANGE_ZONE_AFTER_M 10
+#define START_LINE_COLOR 0x200000
+#define MARKER_COLOR 0x101010
+#define EXCHANGE_ZONE_COLOR 0x000600
+
+// Idle power management between sessions (see power.h)
+#define IDLE_CPU_MHZ 80              // Lowest clock WiFi runs at
+#define RUN_CPU_MHZ 240
+#define IDLE_POLL_MS 10              // Loop period while idle
+#define WAKE_TARGET_MS 25            // Wake to first frame on the strip
+#define STATION_POLL_MS 1000         // Refresh of the connected client count
+
+// Frames are only pushed to the strip when they change, but at least this
+// often so a glitched pixel does not stay wrong
+#define SHOW_KEEPALIVE_MS 1000
+
 #endif
@@ -0,0 +1,65 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include "config.h"
+#include "clock.h"
+
+// Lap event flags
+#define LAP_EVENT_PARTIAL 0x01  // First crossing after a start away from 0m
+
+// One finish-line crossing by one pacer
+struct LapEvent {
+  uint32_t seq;            // Global sequence number (1, 2, 3, ...)
+  uint8_t pacer;           // Pacer index
+  uint8_t flags;
+  uint32_t lap;            // Crossings so far for this pacer (1-based)
+  clock_us_t timestamp;    // Exact crossing time on the pacing clock
+  uint32_t splitMicros;    // Time since the previous crossing (or the start)
+};
+
+// Lock-free single-producer ring buffer of lap events
+// updatePacers() is the only writer. Readers never block it: they copy an
+// entry and then check its seq, so an entry overwritten mid-copy is dropped
+// instead of being returned torn.
+struct LapEventRing {
+  LapEvent entries[EVENT_RING_SIZE];
+  volatile uint32_t head;  // seq of the newest published event (0 = none)
+};
+
+extern LapEventRing lapEvents;
+
+// Append an event (producer side only)
+void pushLapEvent(uint8_t pacer, uint8_t flags, uint32_t lap, clock_us_t timestamp, uint32_t splitMicros) {
+  uint32_t seq = lapEvents.head + 1;
+  LapEvent &e = lapEvents.entries[seq % EVENT_RING_SIZE];
+
+  e.seq = 0;  // Mark as being written
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  e.pacer = pacer;
+  e.flags = flags;
+  e.lap = lap;
+  e.timestamp = timestamp;
+  e.splitMicros = splitMicros;
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  e.seq = seq;
+
+  __atomic_store_n(&lapEvents.head, seq, __ATOMIC_RELEASE);
+}
+
+// Sequence number of the newest event
+uint32_t latestLapEventSeq() {
+  return __atomic_load_n(&lapEvents.head, __ATOMIC_ACQUIRE);
+}
+
+// Copy the event with the given seq into out; false if it was never written
+// or has already been overwritten
+bool readLapEvent(uint32_t seq, LapEvent &out) {
+  const LapEvent &e = lapEvents.entries[seq % EVENT_RING_SIZE];
+
+  if (__atomic_load_n(&e.seq, __ATOMIC_ACQUIRE) != seq) return false;
+  out = e;
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(&e.seq, __ATOMIC_ACQUIRE) == seq && out.seq == seq;
+}
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef GHOST_H
+#define GHOST_H
+
+#include <Preferences.h>
+#include "config.h"
+#include "pace_profile.h"
+#include "arena.h"
+
+// Ghost pacers
+// A ghost replays a recorded race from its split times, e.g. the 100m
+// splits of an 800m personal best. Tables are stored compactly in NVS, one
+// slot each. At START a table becomes a pace profile with one constant-speed
+// step per split, so a ghost costs the same per frame as any other pacer.
+// The ghost stops at the finish of the recorded race.
+
+struct GhostTable {
+  char name[GHOST_NAME_LEN];
+  uint16_t splitDecimeters;               // Distance between splits (1000 = 100m)
+  uint8_t count;
+  uint16_t splitCentis[MAX_PROFILE_STEPS];  // Time of each split, 1/100 s
+};
+
+extern Preferences preferences;
+extern float trackMeters;
+
+// NVS key of a ghost slot, written into key (8 bytes)
+const char* ghostKey(int slot, char *key) {
+  snprintf(key, 8, "ghost%d", slot);
+  return key;
+}
+
+bool loadGhost(int slot, GhostTable &table) {
+  if (slot < 0 || slot >= MAX_GHOSTS) return false;
+
+  char key[8];
+  if (preferences.getBytes(ghostKey(slot, key), &table, sizeof(table)) != sizeof(table)) return false;
+  return table.count > 0 && table.count <= MAX_PROFILE_STEPS && table.splitDecimeters > 0;
+}
+
+void saveGhost(int slot, const GhostTable &table) {
+  char key[8];
+  preferences.putBytes(ghostKey(slot, key), &table, sizeof(table));
+}
+
+// Parse comma-separated split times in seconds into table
+bool parseGhostSplits(StrView text, GhostTable &table) {
+  table.count = 0;
+  int lastPos = 0;
+
+  while (lastPos < text.len) {
+    if (table.count >= MAX_PROFILE_STEPS) return false;
+
+    int comma = text.indexOf(',', lastPos);
+    if (comma == -1) comma = text.len;
+
+    float seconds = text.sub(lastPos, comma).toFloat();
+    if (seconds <= 0 || seconds > 655) return false;
+
+    table.splitCentis[table.count++] = (uint16_t)(seconds * 100 + 0.5);
+    lastPos = comma + 1;
+  }
+
+  return table.count > 0;
+}
+
+// Turn a ghost table into a profile of constant-speed steps that stops at
+// the end of the race. The splits are distances but profile steps are lap
+// times, so the profile is only right for the current trackMeters; the
+// track length cannot change while it runs (see ghostRunning).
+void ghostToProfile(const GhostTable &table, ProfileSpec &spec) {
+  float splitMeters = table.splitDecimeters / 10.0;
+
+  spec.count = table.count;
+  spec.flags = PROFILE_STOP_AT_END | PROFILE_FIXED_TRACK;
+
+  for (int j = 0; j < table.count; j++) {
+    float seconds = table.splitCentis[j] / 100.0;
+    float lapTime = seconds * trackMeters / splitMeters;
+
+    spec.steps[j].seconds = seconds;
+    spec.steps[j].fromLapTime = lapTime;
+    spec.steps[j].toLapTime = lapTime;
+  }
+}
+
+#endif
@@ -0,0 +1,99 @@
+// Position beacon receiver: listens on BEACON_PORT (joining BEACON_GROUP
+// when the beacon is multicast) and reports the packet rate, the packets
+// lost (gaps in seq), those out of order, and latency. Given the steady
+// clock time at which the sender's track clock read 0, as bench_beacon
+// passes it, latency is measured from trackTime to arrival. Otherwise,
+// against a controller on another clock, it is the delay beyond that of the
+// quickest packet. Exits non-zero if nothing valid arrived or more than 1%
+// was lost.
+// Usage: beacon_receiver [seconds] [sender epoch ns]
+
+#include "host_test.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+int64_t steadyNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char **argv) {
+  int seconds = argc > 1 ? atoi(argv[1]) : 5;
+  bool epochKnown = argc > 2;
+  int64_t senderEpoch = epochKnown ? atoll(argv[2]) : 0;
+
+  WiFiUDP udp;
+  if (!udp.begin(BEACON_PORT)) {
+    fprintf(stderr, "beacon_receiver: cannot listen on port %d\n", BEACON_PORT);
+    return 2;
+  }
+#if BEACON_MULTICAST
+  udp.joinGroup(IPAddress(BEACON_GROUP));
+#endif
+
+  static BeaconPacket packet;
+  std::vector<int64_t> latencyUs;
+  uint32_t received = 0, lost = 0, outOfOrder = 0, invalid = 0;
+  uint32_t lastSeq = 0;
+  int64_t first = 0, last = 0;
+  int64_t giveUp = steadyNanos() + (seconds + 5) * 1000000000LL;
+
+  for (;;) {
+    int64_t now = steadyNanos();
+    if (first ? now - first >= seconds * 1000000000LL : now >= giveUp) break;
+
+    int size = udp.parsePacket();
+    if (size == 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+      continue;
+    }
+    if (size != sizeof(packet)) {
+      invalid++;
+      continue;
+    }
+    udp.read((uint8_t*)&packet, sizeof(packet));
+    if (packet.magic != BEACON_MAGIC) {
+      invalid++;
+      continue;
+    }
+
+    if (!first) {
+      first = now;
+    } else if (packet.seq > lastSeq) {
+      lost += packet.seq - lastSeq - 1;
+    } else {
+      outOfOrder++;
+      continue;
+    }
+    lastSeq = packet.seq;
+    last = now;
+    received++;
+    latencyUs.push_back(now / 1000 - senderEpoch / 1000 - (int64_t)packet.trackTime);
+  }
+
+  if (received == 0) {
+    fprintf(stderr, "beacon_receiver: no beacon packets on port %d\n", BEACON_PORT);
+    return 1;
+  }
+
+  std::sort(latencyUs.begin(), latencyUs.end());
+  int64_t base = epochKnown ? 0 : latencyUs.front();
+  double mean = 0;
+  for (int64_t l : latencyUs) mean += l - base;
+  mean /= latencyUs.size();
+
+  double span = (last - first) / 1e9;
+  printf("beacon: %u packets in %.1f s (%.1f per second), %u lost (%.2f%%), %u out of order, %u invalid\n",
+         received, span, span > 0 ? (received - 1) / span : 0.0, lost, lost * 100.0 / (received + lost),
+         outOfOrder, invalid);
+  printf("beacon latency%s: mean %.0f us, median %lld us, p99 %lld us, worst %lld us\n",
+         epochKnown ? "" : " beyond the quickest packet", mean,
+         (long long)(latencyUs[latencyUs.size() / 2] - base),
+         (long long)(latencyUs[latencyUs.size() * 99 / 100] - base), (long long)(latencyUs.back() - base));
+
+  CHECK(invalid == 0);
+  CHECK(lost * 100 <= received + lost);
+  return checkFailures ? 1 : 0;
+}
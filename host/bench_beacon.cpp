@@ -0,0 +1,60 @@
+// Position beacon over loopback, in real time. Runs a session with the
+// beacon on (built with BEACON_ENABLED=1), each frame taking as long to
+// send as a 500-unit strip at 30 us a pixel, and launches beacon_receiver
+// with the steady clock time of the track clock's zero, so it can measure
+// latency against the truth. The receiver reports rate, loss and latency.
+// Usage: bench_beacon [seconds]
+
+#include "host_test.h"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define TRANSFER_US (500 * 30)
+
+static_assert(BEACON_ENABLED, "Build with -DBEACON_ENABLED=1");
+
+int64_t steadyNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char **argv) {
+  int seconds = argc > 1 ? atoi(argv[1]) : 5;
+
+  clockSet(7 * CLOCK_US_PER_SEC);
+  clockSetScale(1.0);
+  int64_t epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      virtualClock.anchorReal.time_since_epoch()).count() - (int64_t)virtualClock.anchorVirtual * 1000;
+
+  std::string receiver = argv[0];
+  receiver = receiver.substr(0, receiver.rfind('/') + 1) + "beacon_receiver";
+  std::string epochArg = std::to_string(epoch), duration = std::to_string(seconds);
+  pid_t child = fork();
+  if (child == 0) {
+    execl(receiver.c_str(), receiver.c_str(), duration.c_str(), epochArg.c_str(), (char*)NULL);
+    _exit(127);
+  }
+
+  hostShowHook = [] { std::this_thread::sleep_for(std::chrono::microseconds(TRANSFER_US)); };
+  bootSketch();
+  CHECK(request(HTTP_POST, "/segments", "SET:80").code == 200);
+  delay(200);
+  CHECK(request(HTTP_POST, "/command", "START:60,0,#FF0000|60,100,#00FF00|60,250,#0000FF|").code == 200);
+
+  uint32_t seqBefore = beaconPacket.seq;
+  int64_t start = steadyNanos(), end = start + (seconds + 1) * 1000000000LL;
+  while (steadyNanos() < end) {
+    loop();
+    delay(1);
+  }
+  printf("sender: %u packets in %d s (%.1f per second)\n", beaconPacket.seq - seqBefore, seconds + 1,
+         (beaconPacket.seq - seqBefore) * 1e9 / (steadyNanos() - start));
+
+  int status;
+  waitpid(child, &status, 0);
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  return checkFailures ? 1 : 0;
+}
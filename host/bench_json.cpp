@@ -0,0 +1,78 @@
+// Throughput of the streaming JSON parser and the preset parsers, fed in
+// HTTP_RAW_BUFLEN chunks as the web server delivers request bodies.
+// Reports bytes per second on this machine.
+
+#include "host_test.h"
+#include <string>
+
+void ignoreEvent(JsonStream &json, JsonEvent event, const char *text) {
+}
+
+const char *PRESET = "{\"name\":\"Tempo %02d\",\"segments\":80,\"pacers\":["
+                     "{\"enabled\":true,\"time\":72.5,\"color\":\"#FF0000\",\"position\":0},"
+                     "{\"enabled\":true,\"time\":75.25,\"color\":\"#00FF00\",\"position\":100},"
+                     "{\"enabled\":false,\"time\":80,\"color\":\"#0000FF\",\"position\":200}]}";
+
+// A library of count presets with distinct names
+std::string library(int count) {
+  std::string doc = "[";
+  for (int i = 0; i < count; i++) {
+    char preset[512];
+    snprintf(preset, sizeof(preset), PRESET, i % 100);
+    if (i > 0) doc += ",";
+    doc += preset;
+  }
+  return doc + "]";
+}
+
+// Parse doc repeatedly for about a second; bytes per second
+template<typename Setup>
+double throughput(const std::string &doc, JsonHandler handler, Setup setup) {
+  uint64_t bytes = 0;
+  uint64_t start = hostNanos();
+  uint64_t elapsed;
+
+  do {
+    JsonStream json;
+    jsonBegin(json, handler, setup());
+    for (size_t at = 0; at < doc.size(); at += HTTP_RAW_BUFLEN) {
+      jsonFeed(json, doc.data() + at, min((size_t)HTTP_RAW_BUFLEN, doc.size() - at));
+    }
+    if (!jsonFinish(json)) {
+      printf("parse failed: %s\n", json.error);
+      exit(1);
+    }
+    bytes += doc.size();
+    elapsed = hostNanos() - start;
+  } while (elapsed < 1000000000ULL);
+
+  return bytes * 1e9 / elapsed;
+}
+
+void report(const char *what, size_t size, double rate) {
+  printf("%-34s %7zu bytes  %8.1f MB/s\n", what, size, rate / 1e6);
+}
+
+int main() {
+  preferences.begin("trackpacer", false);
+
+  std::string big = library(2000);
+  report("tokenizer only", big.size(), throughput(big, ignoreEvent, [] { return (void*)NULL; }));
+
+  char one[512];
+  snprintf(one, sizeof(one), PRESET, 1);
+  PresetParse preset;
+  report("single preset (/preset/save)", strlen(one), throughput(one, presetDocumentEvent, [&] {
+    beginPresetParse(preset, 1);
+    return (void*)&preset;
+  }));
+
+  std::string full = library(MAX_PRESETS);
+  PresetImport import;
+  report("library with NVS writes (import)", full.size(), throughput(full, presetLibraryEvent, [&] {
+    beginPresetImport(import);
+    return (void*)&import;
+  }));
+
+  return 0;
+}
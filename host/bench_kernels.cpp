@@ -0,0 +1,89 @@
+// Cost of the frame kernels for 1 to 3 pacers on a 400 m track with
+// trails, on this machine:
+//  - specialized: updateKernel<N> and renderKernel<N>, as the sketch runs
+//  - generic: the COUNT 0 loops over the hot block
+//  - reference update: the same positions computed the way they were before
+//    the hot block, visiting every configured pacer behind an enabled check
+//    and working out its lane lap time and start phase from the cold
+//    configuration every frame. Its positions are checked against the
+//    kernels'.
+// Usage: bench_kernels [frames]
+
+#include "host_test.h"
+
+#define FRAME_US 16667
+
+uint16_t referenceHead[MAX_PACERS];
+
+void referenceUpdate(clock_us_t now) {
+  for (int i = 0; i < MAX_PACERS; i++) {
+    if (!pacers[i].enabled) continue;
+
+    float laneScale = pacerLapMeters(pacers[i]) / trackMeters;
+    clock_us_t lapMicros = (clock_us_t)(pacers[i].timePerLap * laneScale * CLOCK_US_PER_SEC);
+    clock_us_t elapsed = now > pacers[i].startTime ? now - pacers[i].startTime : 0;
+    uint64_t total = ((elapsed << 16) / lapMicros) + pacerStartPhase(pacers[i]);
+
+    referenceHead[i] = phaseToUnits16((uint32_t)(total & 0xFFFF)) >> 4;
+  }
+}
+
+// Nanoseconds per frame of step(now) over frames frames
+template<typename Step>
+double timeFrames(int frames, Step step) {
+  resetFrame();
+  clock_us_t now = sessionStartTime;
+  uint64_t start = hostNanos();
+  for (int frame = 0; frame < frames; frame++) {
+    now += FRAME_US;
+    step(now);
+  }
+  return (double)(hostNanos() - start) / frames;
+}
+
+template<int N>
+void benchCount(int frames) {
+  static const char *commands[] = {
+    "72.5,0,#FF0000,0,5|",
+    "72.5,0,#FF0000,0,5|61.25,100,#00FF00,0,5|",
+    "72.5,0,#FF0000,0,5|61.25,100,#00FF00,0,5|80,200,#0000FF,0,5|",
+  };
+  sessionStartTime = trackMicros();
+  parseStartCommand(strView(commands[N - 1]), sessionStartTime);
+  CHECK(pacerHot.count == N);
+
+  double specializedUpdate = timeFrames(frames, [](clock_us_t now) { updateKernel<N>(now); });
+  double genericUpdate = timeFrames(frames, [](clock_us_t now) { updateKernel<0>(now); });
+  double reference = timeFrames(frames, [](clock_us_t now) { referenceUpdate(now); });
+
+  double specialized = timeFrames(frames, [](clock_us_t now) { updateKernel<N>(now); renderKernel<N>(); });
+  double generic = timeFrames(frames, [](clock_us_t now) { updateKernel<0>(now); renderKernel<0>(); });
+
+  // Same positions either way
+  clock_us_t now = sessionStartTime + 1234567 * CLOCK_US_PER_MS;
+  updateKernel<N>(now);
+  referenceUpdate(now);
+  for (int s = 0; s < N; s++) CHECK(pacerHot.head[s] == referenceHead[pacerHot.pacer[s]]);
+
+  printf("%d pacer%s  update: specialized %5.1f ns, generic %5.1f ns, reference %5.1f ns (%.1fx)   "
+         "update+render: specialized %6.1f ns, generic %6.1f ns\n",
+         N, N > 1 ? "s" : " ", specializedUpdate, genericUpdate, reference, reference / specializedUpdate,
+         specialized, generic);
+}
+
+int main(int argc, char **argv) {
+  int frames = argc > 1 ? atoi(argv[1]) : 200000;
+
+  preferences.begin("trackpacer", false);
+  TOTAL_SEGMENTS = 80;
+  current_NUM_LEDS = TOTAL_SEGMENTS * LOGICAL_UNITS_PER_SEGMENT;
+  loadCalibration();
+  loadLanes();
+  buildCalibration();
+  buildBackground();
+
+  benchCount<1>(frames);
+  benchCount<2>(frames);
+  benchCount<3>(frames);
+  return checkFailures ? 1 : 0;
+}
@@ -0,0 +1,66 @@
+// Frame cost with every lane busy: 8 lanes of 500 units, three pacers on
+// each (built with NUM_LANES=8 and MAX_PACERS=24), staggered as on a 400 m
+// oval and trailing comets. Times updatePacers() plus renderLEDs() per frame
+// on this machine; the batched pass over all lanes is what a frame costs.
+// Usage: bench_lanes [frames]
+
+#include "host_test.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#define FRAME_US 16667
+
+static_assert(NUM_LANES == 8 && MAX_PACERS == 24, "Build with -DNUM_LANES=8 -DMAX_PACERS=24");
+
+int main(int argc, char **argv) {
+  int frames = argc > 1 ? atoi(argv[1]) : 20000;
+
+  preferences.begin("trackpacer", false);
+  TOTAL_SEGMENTS = 10;
+  current_NUM_LEDS = TOTAL_SEGMENTS * LOGICAL_UNITS_PER_SEGMENT;
+  loadCalibration();
+  loadLanes();
+  buildCalibration();
+
+  // About 7.67 m more per lane outward, and a stagger that makes up for it
+  for (int l = 0; l < NUM_LANES; l++) {
+    lanes[l].extraMeters = 7.67f * l;
+    lanes[l].staggerMeters = 7.04f * l;
+  }
+  buildBackground();
+
+  std::string command;
+  const char *colors[] = {"#FF0000", "#00FF00", "#0000FF"};
+  for (int l = 0; l < NUM_LANES; l++) {
+    for (int k = 0; k < 3; k++) {
+      char pacer[64];
+      snprintf(pacer, sizeof(pacer), "%.2f,%d,%s,%d,5|", 8 + l * 0.25 + k * 0.5, k * 15, colors[k], l);
+      command += pacer;
+    }
+  }
+  sessionStartTime = trackMicros();
+  parseStartCommand(strView(command.c_str()), sessionStartTime);
+  CHECK(pacerHot.count == NUM_LANES * 3);
+
+  std::vector<uint64_t> times;
+  times.reserve(frames);
+  for (int frame = 0; frame < frames; frame++) {
+    clockStep(FRAME_US);
+    uint64_t start = hostNanos();
+    updatePacers();
+    renderLEDs();
+    times.push_back(hostNanos() - start);
+  }
+
+  std::sort(times.begin(), times.end());
+  double total = 0;
+  for (uint64_t t : times) total += t;
+  double mean = total / frames / 1e3;
+
+  printf("%d lanes x 3 pacers, %d units each: %.1f us per frame (median %.1f, p99 %.1f, worst %.1f), "
+         "%.2f%% of a 60 fps frame, %.2f us per pacer\n",
+         NUM_LANES, current_NUM_LEDS, mean, times[frames / 2] / 1e3, times[frames * 99 / 100] / 1e3,
+         times.back() / 1e3, mean * 100 / FRAME_US, mean / pacerHot.count);
+  return checkFailures ? 1 : 0;
+}
@@ -0,0 +1,59 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+// Shared by the host tests and benchmarks: the whole sketch as one
+// translation unit, as the Arduino build compiles it, against the stubs in
+// stubs/, plus checks and helpers for driving it
+
+#include "../TrackPacingSystem.ino"
+#include <time.h>
+
+int checkFailures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+      fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+      checkFailures++; \
+    } \
+  } while (0)
+
+#define CHECK_NEAR(a, b, tolerance) do { \
+    double checkA = (double)(a), checkB = (double)(b); \
+    if (fabs(checkA - checkB) > (tolerance)) { \
+      fprintf(stderr, "%s:%d: CHECK failed: %s = %.3f, %s = %.3f\n", __FILE__, __LINE__, #a, checkA, #b, checkB); \
+      checkFailures++; \
+    } \
+  } while (0)
+
+// Print the outcome and give the exit status for main()
+int testResult(const char *name) {
+  printf("%s: %s\n", name, checkFailures ? "FAILED" : "ok");
+  return checkFailures ? 1 : 0;
+}
+
+// Boot the sketch as the board would: setup(), then wait for the network
+// task to bring up the server
+void bootSketch() {
+  setup();
+  while (!networkReady) delay(1);
+}
+
+// Serve a request and end it as loop() would
+HostResponse request(HTTPMethod method, const char *uri, const std::string &body = "") {
+  HostRequest r;
+  r.method = method;
+  r.uri = uri;
+  r.body = body;
+  HostResponse response = server.hostServe(r);
+  endRequest();
+  return response;
+}
+
+// Wall-clock nanoseconds, for benchmarks
+uint64_t hostNanos() {
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+#endif
@@ -0,0 +1,256 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Host stand-in for the ESP32 Arduino core: just what the sketch uses, with
+// working implementations so the sketch links and runs on a desktop.
+// FreeRTOS tasks are threads; micros() is a 32-bit counter the test sets.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+
+#define PROGMEM
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+#define RTC_DATA_ATTR
+
+using std::min;
+using std::max;
+#define constrain(x, low, high) ((x) < (low) ? (low) : ((x) > (high) ? (high) : (x)))
+
+// Raw 32-bit microsecond counter; only read by clock.h's ARDUINO branch,
+// so a test built with -DARDUINO can run it across the wrap
+inline uint32_t hostMicros32 = 0;
+
+inline unsigned long micros() { return hostMicros32; }
+inline unsigned long millis() { return hostMicros32 / 1000; }
+
+inline void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// Heap accounting. A test can count the allocations the sketch makes while
+// hostSketchHeap is set (the web server stand-in sets it while a handler
+// runs). The stand-ins allocate where the real libraries need not (string
+// keys, vectors), so their methods clear it for their own duration with a
+// HostLibraryCall.
+inline thread_local bool hostSketchHeap = false;
+
+struct HostLibraryCall {
+  bool saved;
+  HostLibraryCall() : saved(hostSketchHeap) { hostSketchHeap = false; }
+  ~HostLibraryCall() { hostSketchHeap = saved; }
+};
+
+inline void yield() {
+  std::this_thread::yield();
+}
+
+class String {
+public:
+  String() {}
+  String(const char *text) : s(text ? text : "") {}
+  String(const std::string &text) : s(text) {}
+
+  unsigned length() const { return s.size(); }
+  const char* c_str() const { return s.c_str(); }
+  bool operator==(const char *text) const { return s == text; }
+  bool operator==(const String &other) const { return s == other.s; }
+
+private:
+  std::string s;
+};
+
+class IPAddress {
+public:
+  IPAddress() : bytes{0, 0, 0, 0} {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes{a, b, c, d} {}
+  // Same layout as the ESP32 core: first octet in the low byte
+  IPAddress(uint32_t address) {
+    memcpy(bytes, &address, 4);
+  }
+
+  operator uint32_t() const {
+    uint32_t address;
+    memcpy(&address, bytes, 4);
+    return address;
+  }
+
+  uint8_t operator[](int i) const { return bytes[i]; }
+
+  String toString() const {
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+    return String(text);
+  }
+
+private:
+  uint8_t bytes[4];
+};
+
+// Serial output is dropped unless the environment sets HOST_SERIAL
+class HostSerial {
+public:
+  void begin(unsigned long) {}
+
+  void print(const char *text) { if (echo()) fputs(text, stderr); }
+  void print(const String &text) { print(text.c_str()); }
+  void print(const IPAddress &ip) { print(ip.toString()); }
+  void print(char c) { if (echo()) fputc(c, stderr); }
+  void print(int n) { print((long long)n); }
+  void print(unsigned n) { print((unsigned long long)n); }
+  void print(long n) { print((long long)n); }
+  void print(unsigned long n) { print((unsigned long long)n); }
+  void print(long long n) { if (echo()) fprintf(stderr, "%lld", n); }
+  void print(unsigned long long n) { if (echo()) fprintf(stderr, "%llu", n); }
+  void print(double x) { if (echo()) fprintf(stderr, "%.2f", x); }
+
+  template<typename T>
+  void println(const T &value) {
+    print(value);
+    print('\n');
+  }
+
+  void println() { print('\n'); }
+
+private:
+  static bool echo() {
+    static bool on = getenv("HOST_SERIAL") != NULL;
+    return on;
+  }
+};
+
+inline HostSerial Serial;
+
+// FreeRTOS tasks as threads. Each task has a notification count, as
+// ulTaskNotifyTake/xTaskNotifyGive use it.
+struct HostTask {
+  std::mutex lock;
+  std::condition_variable wake;
+  uint32_t notified = 0;
+};
+
+typedef HostTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+typedef int BaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xFFFFFFFF
+
+inline thread_local HostTask *hostCurrentTask = NULL;
+
+struct HostTaskExit {};
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stack,
+                                          void *param, int priority, TaskHandle_t *handle, int core) {
+  HostTask *task = new HostTask;
+  if (handle) *handle = task;
+
+  std::thread([code, param, task] {
+    hostCurrentTask = task;
+    try {
+      code(param);
+    } catch (HostTaskExit&) {
+    }
+  }).detach();
+  return pdPASS;
+}
+
+// Only ever called by a task on itself
+inline void vTaskDelete(TaskHandle_t) {
+  throw HostTaskExit();
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, uint32_t wait) {
+  HostTask *task = hostCurrentTask;
+  std::unique_lock<std::mutex> hold(task->lock);
+  task->wake.wait(hold, [task] { return task->notified > 0; });
+
+  uint32_t count = task->notified;
+  task->notified = clear ? 0 : count - 1;
+  return count;
+}
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  {
+    std::lock_guard<std::mutex> hold(task->lock);
+    task->notified++;
+  }
+  task->wake.notify_one();
+  return pdPASS;
+}
+
+// Binary semaphores: a count of 0 or 1. Waits are in ticks of 1 ms.
+struct HostSemaphore {
+  std::mutex lock;
+  std::condition_variable given;
+  int count = 0;
+};
+
+typedef HostSemaphore* SemaphoreHandle_t;
+typedef unsigned UBaseType_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateBinary() {
+  return new HostSemaphore;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  {
+    std::lock_guard<std::mutex> hold(semaphore->lock);
+    if (semaphore->count) return pdFALSE;
+    semaphore->count = 1;
+  }
+  semaphore->given.notify_one();
+  return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, uint32_t wait) {
+  std::unique_lock<std::mutex> hold(semaphore->lock);
+  auto given = [semaphore] { return semaphore->count > 0; };
+  if (wait == 0) {
+    if (!given()) return pdFALSE;
+  } else if (wait == portMAX_DELAY) {
+    semaphore->given.wait(hold, given);
+  } else if (!semaphore->given.wait_for(hold, std::chrono::milliseconds(wait), given)) {
+    return pdFALSE;
+  }
+  semaphore->count = 0;
+  return pdTRUE;
+}
+
+inline UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore) {
+  std::lock_guard<std::mutex> hold(semaphore->lock);
+  return semaphore->count;
+}
+
+// Heap figures for /status; a test that counts allocations reports its own
+struct HostEsp {
+  uint32_t getFreeHeap() { return 200000; }
+  uint32_t getMinFreeHeap() { return 200000; }
+};
+
+inline HostEsp ESP;
+
+inline uint32_t hostCpuMhz = 240;
+
+inline bool setCpuFrequencyMhz(uint32_t mhz) {
+  hostCpuMhz = mhz;
+  return true;
+}
+
+inline uint32_t getCpuFrequencyMhz() {
+  return hostCpuMhz;
+}
+
+#endif
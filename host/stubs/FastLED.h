@@ -0,0 +1,73 @@
+#ifndef HOST_FASTLED_H
+#define HOST_FASTLED_H
+
+// Host stand-in for FastLED. Pixel math matches the library's; show()
+// sends nothing but calls hostShowHook, so a test can time or inspect the
+// buffers registered with addLeds() while a frame is "on the wire".
+
+#include <Arduino.h>
+#include <functional>
+
+struct CRGB {
+  uint8_t r, g, b;
+
+  CRGB() : r(0), g(0), b(0) {}
+  CRGB(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue) {}
+  CRGB(uint32_t color) : r(color >> 16), g(color >> 8), b(color) {}
+
+  bool operator==(const CRGB &o) const { return r == o.r && g == o.g && b == o.b; }
+  bool operator!=(const CRGB &o) const { return !(*this == o); }
+};
+
+enum EOrder { RGB, RBG, GRB };
+enum ESPIChipsets { WS2811, WS2812B };
+
+inline std::function<void()> hostShowHook;
+
+struct HostLedOutput {
+  CRGB *pixels;
+  int count;
+};
+
+class CFastLED {
+public:
+  template<ESPIChipsets CHIPSET, int PIN, EOrder ORDER>
+  void addLeds(CRGB *pixels, int count) {
+    outputs[outputCount++] = HostLedOutput{pixels, count};
+  }
+
+  void setBrightness(uint8_t scale) { brightness = scale; }
+
+  void show() {
+    if (hostShowHook) hostShowHook();
+  }
+
+  HostLedOutput outputs[8];
+  int outputCount = 0;
+  uint8_t brightness = 255;
+};
+
+inline CFastLED FastLED;
+
+inline void fill_solid(CRGB *pixels, int count, const CRGB &color) {
+  for (int i = 0; i < count; i++) pixels[i] = color;
+}
+
+// FastLED's blend8: a + (b - a) * amountOfB / 256, rounded
+inline uint8_t blend8(uint8_t a, uint8_t b, uint8_t amountOfB) {
+  uint16_t partial = (a << 8) | b;
+  partial += (b * amountOfB);
+  partial -= (a * amountOfB);
+  return partial >> 8;
+}
+
+inline CRGB* blend(const CRGB *src1, const CRGB *src2, CRGB *dest, uint16_t count, uint8_t amountOfSrc2) {
+  for (uint16_t i = 0; i < count; i++) {
+    dest[i] = CRGB(blend8(src1[i].r, src2[i].r, amountOfSrc2),
+                   blend8(src1[i].g, src2[i].g, amountOfSrc2),
+                   blend8(src1[i].b, src2[i].b, amountOfSrc2));
+  }
+  return dest;
+}
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+// Host stand-in for LittleFS: files are byte vectors in memory
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+typedef std::shared_ptr<std::vector<uint8_t>> HostFileData;
+
+class File {
+public:
+  File() : pos(0) {}
+  File(HostFileData contents, size_t position) : data(contents), pos(position) {}
+
+  operator bool() const { return data != nullptr; }
+
+  size_t write(const uint8_t *buf, size_t len) {
+    HostLibraryCall call;
+    if (!data) return 0;
+    data->insert(data->end(), buf, buf + len);
+    pos = data->size();
+    return len;
+  }
+
+  size_t read(uint8_t *buf, size_t len) {
+    if (!data || pos >= data->size()) return 0;
+    size_t n = min(len, data->size() - pos);
+    memcpy(buf, data->data() + pos, n);
+    pos += n;
+    return n;
+  }
+
+  size_t size() const { return data ? data->size() : 0; }
+  void close() { HostLibraryCall call; data = nullptr; }
+
+private:
+  HostFileData data;
+  size_t pos;
+};
+
+class HostFS {
+public:
+  bool begin(bool formatOnFail = false) { return true; }
+
+  File open(const char *path, const char *mode = FILE_READ) {
+    HostLibraryCall call;
+    auto entry = files.find(path);
+    if (mode[0] == 'r') {
+      return entry == files.end() ? File() : File(entry->second, 0);
+    }
+
+    if (entry == files.end() || mode[0] == 'w') {
+      files[path] = std::make_shared<std::vector<uint8_t>>();
+    }
+    HostFileData contents = files[path];
+    return File(contents, contents->size());
+  }
+
+  bool exists(const char *path) { HostLibraryCall call; return files.count(path) > 0; }
+  bool remove(const char *path) { HostLibraryCall call; return files.erase(path) > 0; }
+
+  bool rename(const char *from, const char *to) {
+    HostLibraryCall call;
+    auto entry = files.find(from);
+    if (entry == files.end()) return false;
+    files[to] = entry->second;
+    files.erase(from);
+    return true;
+  }
+
+  std::map<std::string, HostFileData> files;
+};
+
+inline HostFS LittleFS;
+
+#endif
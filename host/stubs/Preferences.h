@@ -0,0 +1,68 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+// Host stand-in for NVS Preferences, over the store in nvs.h
+
+#include <Arduino.h>
+#include <nvs.h>
+
+class Preferences {
+public:
+  bool begin(const char *name, bool readOnly = false) {
+    HostLibraryCall call;
+    space = std::string(name) + "/";
+    return true;
+  }
+
+  void end() {}
+
+  bool isKey(const char *key) { HostLibraryCall call; return hostNvs.count(space + key) > 0; }
+  bool remove(const char *key) { HostLibraryCall call; return hostNvs.erase(space + key) > 0; }
+
+  size_t putBytes(const char *key, const void *value, size_t len) {
+    return put(key, NVS_TYPE_BLOB, value, len);
+  }
+
+  size_t getBytesLength(const char *key) {
+    HostLibraryCall call;
+    auto entry = hostNvs.find(space + key);
+    return entry == hostNvs.end() ? 0 : entry->second.value.size();
+  }
+
+  size_t getBytes(const char *key, void *buf, size_t maxLen) {
+    HostLibraryCall call;
+    auto entry = hostNvs.find(space + key);
+    if (entry == hostNvs.end() || entry->second.value.size() > maxLen) return 0;
+    memcpy(buf, entry->second.value.data(), entry->second.value.size());
+    return entry->second.value.size();
+  }
+
+  size_t putUChar(const char *key, uint8_t value) { return put(key, NVS_TYPE_U8, &value, 1); }
+
+  uint8_t getUChar(const char *key, uint8_t defaultValue = 0) {
+    uint8_t value = defaultValue;
+    getBytes(key, &value, 1);
+    return value;
+  }
+
+  // Strings are stored with their terminator, whose length getString() returns
+  size_t putString(const char *key, const char *value) {
+    return put(key, NVS_TYPE_STR, value, strlen(value) + 1) - 1;
+  }
+
+  size_t getString(const char *key, char *value, size_t maxLen) {
+    return getBytes(key, value, maxLen);
+  }
+
+private:
+  std::string space;
+
+  size_t put(const char *key, nvs_type_t type, const void *value, size_t len) {
+    HostLibraryCall call;
+    const uint8_t *bytes = (const uint8_t*)value;
+    hostNvs[space + key] = HostNvsEntry{type, std::vector<uint8_t>(bytes, bytes + len)};
+    return len;
+  }
+};
+
+#endif
@@ -0,0 +1,243 @@
+#ifndef HOST_WEBSERVER_H
+#define HOST_WEBSERVER_H
+
+// Host stand-in for the ESP32 WebServer. Tests hand it requests instead of
+// it reading them from sockets: hostServe() runs one at once, or
+// hostQueue() leaves it for handleClient(), which like the real server
+// answers at most one request per call. Routes, arguments, headers, raw
+// body uploads and chunked responses behave as on the device, and every
+// response is recorded as a HostResponse.
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiClient.h>
+#include <deque>
+#include <functional>
+#include <map>
+#include <vector>
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_POST };
+
+enum HTTPRawStatus { RAW_START, RAW_WRITE, RAW_END, RAW_ABORTED };
+
+#define HTTP_RAW_BUFLEN 1436
+#define CONTENT_LENGTH_UNKNOWN ((size_t) -1)
+
+struct HTTPRaw {
+  HTTPRawStatus status;
+  size_t totalSize;
+  size_t currentSize;
+  uint8_t buf[HTTP_RAW_BUFLEN];
+};
+
+struct HostRequest {
+  HTTPMethod method = HTTP_GET;
+  std::string uri;
+  std::map<std::string, std::string> args;     // Query arguments
+  std::map<std::string, std::string> headers;
+  std::string body;                            // "plain", or the raw upload on upload routes
+  uint32_t clientIp = (uint32_t)IPAddress(192, 168, 4, 2);
+};
+
+struct HostResponse {
+  int code = 0;
+  std::string contentType;
+  std::string body;
+  std::map<std::string, std::string> headers;
+  bool chunked = false;
+  bool complete = false;     // Whole response sent (final chunk, if chunked)
+  bool aborted = false;      // Connection dropped by the handler
+};
+
+typedef std::function<void(void)> THandlerFunction;
+
+class WebServer {
+public:
+  WebServer(int port) {}
+
+  void on(const char *uri, HTTPMethod method, THandlerFunction handler) {
+    on(uri, method, handler, nullptr);
+  }
+
+  void on(const char *uri, HTTPMethod method, THandlerFunction handler, THandlerFunction upload) {
+    routes.push_back(Route{uri, method, handler, upload});
+  }
+
+  void begin() {}
+
+  void collectHeaders(const char *names[], size_t count) {}
+
+  void handleClient() {
+    if (pending.empty()) return;
+    HostRequest request = pending.front();
+    pending.pop_front();
+    hostServe(request);
+  }
+
+  // As on the device, these return copies, and a copy too long for the
+  // String's own buffer allocates; handlers use RequestServer's instead
+  bool hasArg(const String &name) const { return findIn(_currentArgs, _currentArgCount, name) != NULL; }
+  String arg(const String &name) const { const String *value = findIn(_currentArgs, _currentArgCount, name); return value ? *value : String(); }
+
+  bool hasHeader(const String &name) const { return findIn(_currentHeaders, _headerKeysCount, name) != NULL; }
+  String header(const String &name) const { const String *value = findIn(_currentHeaders, _headerKeysCount, name); return value ? *value : String(); }
+
+  WiFiClient client() { return WiFiClient(request.clientIp, &response.aborted); }
+
+  HTTPRaw& raw() { return rawUpload; }
+
+  void sendHeader(const char *name, const char *value, bool first = false) {
+    HostLibraryCall call;
+    response.headers[name] = value;
+  }
+
+  void setContentLength(size_t length) {
+    response.chunked = length == CONTENT_LENGTH_UNKNOWN;
+  }
+
+  void send(int code, const char *contentType, const char *content) {
+    send_P(code, contentType, content, strlen(content));
+  }
+
+  void send(int code, const char *contentType, const String &content) {
+    send(code, contentType, content.c_str());
+  }
+
+  void send_P(int code, const char *contentType, const char *content) {
+    send(code, contentType, content);
+  }
+
+  void send_P(int code, const char *contentType, const char *content, size_t length) {
+    HostLibraryCall call;
+    response.code = code;
+    response.contentType = contentType;
+    response.body.assign(content, length);
+    response.complete = !response.chunked;
+  }
+
+  void sendContent(const char *content, size_t length) {
+    HostLibraryCall call;
+    if (length == 0) response.complete = true;
+    response.body.append(content, length);
+  }
+
+  void sendContent(const char *content) {
+    sendContent(content, strlen(content));
+  }
+
+  // Queue a request for handleClient()
+  void hostQueue(const HostRequest &next) {
+    pending.push_back(next);
+  }
+
+  size_t hostPending() const { return pending.size(); }
+
+  // Route a request to its handler now and return the response
+  HostResponse hostServe(const HostRequest &next) {
+    request = next;
+    response = HostResponse();
+
+    const Route *route = NULL;
+    for (const Route &r : routes) {
+      if (r.uri == request.uri && (r.method == HTTP_ANY || r.method == request.method)) route = &r;
+    }
+
+    if (!route) {
+      response.code = 404;
+      response.complete = true;
+    } else {
+      bool upload = route->upload && request.method == HTTP_POST;
+      if (!upload && request.method == HTTP_POST && !request.body.empty()) {
+        request.args["plain"] = request.body;
+      }
+      holdRequest();
+
+      if (upload) feedUpload(*route);
+      runHandler(route->handler);
+    }
+
+    if (hostOnResponse) hostOnResponse(request, response);
+    return response;
+  }
+
+  std::function<void(const HostRequest&, const HostResponse&)> hostOnResponse;
+
+protected:
+  // The request as the ESP32 server holds it while a handler runs
+  struct RequestArgument {
+    String key;
+    String value;
+  };
+
+  RequestArgument *_currentArgs = NULL;
+  int _currentArgCount = 0;
+  RequestArgument *_postArgs = NULL;    // Form fields; the host sends none
+  int _postArgsLen = 0;
+  RequestArgument *_currentHeaders = NULL;
+  int _headerKeysCount = 0;
+
+private:
+  struct Route {
+    std::string uri;
+    HTTPMethod method;
+    THandlerFunction handler;
+    THandlerFunction upload;
+  };
+
+  static const String* findIn(const RequestArgument *list, int count, const String &name) {
+    for (int i = 0; i < count; i++) {
+      if (list[i].key == name) return &list[i].value;
+    }
+    return NULL;
+  }
+
+  // Parse the request into the arguments and headers the handlers read
+  void holdRequest() {
+    heldArgs.clear();
+    for (auto &arg : request.args) heldArgs.push_back(RequestArgument{String(arg.first), String(arg.second)});
+    heldHeaders.clear();
+    for (auto &header : request.headers) heldHeaders.push_back(RequestArgument{String(header.first), String(header.second)});
+
+    _currentArgs = heldArgs.data();
+    _currentArgCount = heldArgs.size();
+    _currentHeaders = heldHeaders.data();
+    _headerKeysCount = heldHeaders.size();
+  }
+
+  // Run a handler with its heap use counted as the sketch's
+  void runHandler(const THandlerFunction &handler) {
+    hostSketchHeap = true;
+    handler();
+    hostSketchHeap = false;
+  }
+
+  // The body in HTTP_RAW_BUFLEN pieces, as the server reads it
+  void feedUpload(const Route &route) {
+    rawUpload.totalSize = 0;
+    rawUpload.currentSize = 0;
+    rawUpload.status = RAW_START;
+    runHandler(route.upload);
+
+    for (size_t at = 0; at < request.body.size(); at += HTTP_RAW_BUFLEN) {
+      size_t n = min((size_t)HTTP_RAW_BUFLEN, request.body.size() - at);
+      memcpy(rawUpload.buf, request.body.data() + at, n);
+      rawUpload.currentSize = n;
+      rawUpload.totalSize += n;
+      rawUpload.status = RAW_WRITE;
+      runHandler(route.upload);
+    }
+
+    rawUpload.status = RAW_END;
+    runHandler(route.upload);
+  }
+
+  std::vector<Route> routes;
+  std::deque<HostRequest> pending;
+  HostRequest request;
+  HostResponse response;
+  HTTPRaw rawUpload;
+  std::vector<RequestArgument> heldArgs;
+  std::vector<RequestArgument> heldHeaders;
+};
+
+#endif
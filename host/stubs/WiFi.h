@@ -0,0 +1,27 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+// Host stand-in for the WiFi driver. The "network" is the loopback
+// interface: broadcasts go to 127.255.255.255, which every socket bound to
+// the port receives, so several host processes can play leader, followers
+// and displays on one machine.
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include <WiFiClient.h>
+
+inline int hostStations = 0;  // What softAPgetStationNum() reports
+
+class HostWiFi {
+public:
+  bool softAP(const char *ssid, const char *password = NULL, int channel = 1, int hidden = 0, int maxConnections = 4) { return true; }
+  IPAddress softAPIP() { return IPAddress(192, 168, 4, 1); }
+  IPAddress softAPBroadcastIP() { return IPAddress(127, 255, 255, 255); }
+  int softAPgetStationNum() { return hostStations; }
+  bool begin(const char *ssid, const char *password) { return true; }
+  bool setSleep(bool enabled) { return true; }
+};
+
+inline HostWiFi WiFi;
+
+#endif
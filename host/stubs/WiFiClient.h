@@ -0,0 +1,25 @@
+#ifndef HOST_WIFICLIENT_H
+#define HOST_WIFICLIENT_H
+
+// Host stand-in for the web server's view of a client connection
+
+#include <Arduino.h>
+
+class WiFiClient {
+public:
+  WiFiClient() : ip(0), stopped(NULL) {}
+  WiFiClient(uint32_t address, bool *stopFlag) : ip(address), stopped(stopFlag) {}
+
+  IPAddress remoteIP() const { return IPAddress(ip); }
+
+  // Drop the connection; the server stub marks the response aborted
+  void stop() {
+    if (stopped) *stopped = true;
+  }
+
+private:
+  uint32_t ip;
+  bool *stopped;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef HOST_WIFIUDP_H
+#define HOST_WIFIUDP_H
+
+// Host stand-in for WiFiUDP over real non-blocking UDP sockets. Bound
+// sockets share their port (SO_REUSEADDR), so every process listening on it
+// gets each broadcast or multicast datagram; multicast is sent out of and
+// looped back on the loopback interface.
+
+#include <Arduino.h>
+#include <vector>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+class WiFiUDP {
+public:
+  ~WiFiUDP() { stop(); }
+
+  uint8_t begin(uint16_t port) {
+    if (!open()) return 0;
+
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(port);
+    return bind(fd, (sockaddr*)&local, sizeof(local)) == 0;
+  }
+
+  // Receive a multicast group's traffic as well (for receivers). Only the
+  // groups joined on this socket are received, and Linux allows 20 per
+  // socket.
+  bool joinGroup(IPAddress group) {
+    int off = 0;
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_ALL, &off, sizeof(off));
+
+    ip_mreq request = {};
+    request.imr_multiaddr.s_addr = (uint32_t)group;
+    request.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+    return fd >= 0 && setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)) == 0;
+  }
+
+  void stop() {
+    if (fd >= 0) close(fd);
+    fd = -1;
+  }
+
+  int beginPacket(IPAddress ip, uint16_t port) {
+    if (!open()) return 0;
+    dest = {};
+    dest.sin_family = AF_INET;
+    dest.sin_addr.s_addr = (uint32_t)ip;
+    dest.sin_port = htons(port);
+    out.clear();
+    return 1;
+  }
+
+  size_t write(const uint8_t *buf, size_t len) {
+    out.insert(out.end(), buf, buf + len);
+    return len;
+  }
+
+  int endPacket() {
+    return sendto(fd, out.data(), out.size(), 0, (sockaddr*)&dest, sizeof(dest)) == (ssize_t)out.size();
+  }
+
+  // Size of the next datagram, now readable with read(); 0 if none waiting
+  int parsePacket() {
+    if (fd < 0) return 0;
+    in.resize(65536);
+    ssize_t n = recv(fd, in.data(), in.size(), MSG_DONTWAIT);
+    inPos = 0;
+    in.resize(n > 0 ? n : 0);
+    return in.size();
+  }
+
+  int read(uint8_t *buf, size_t len) {
+    size_t n = min(len, in.size() - inPos);
+    memcpy(buf, in.data() + inPos, n);
+    inPos += n;
+    return n;
+  }
+
+private:
+  bool open() {
+    if (fd >= 0) return true;
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) return false;
+
+    int on = 1;
+    in_addr loopback = {htonl(INADDR_LOOPBACK)};
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &loopback, sizeof(loopback));
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &on, sizeof(on));
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return true;
+  }
+
+  int fd = -1;
+  sockaddr_in dest = {};
+  std::vector<uint8_t> out;
+  std::vector<uint8_t> in;
+  size_t inPos = 0;
+};
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef HOST_NVS_H
+#define HOST_NVS_H
+
+// Host stand-in for the ESP-IDF NVS API: the store Preferences writes to,
+// one in-memory map per process that outlives Preferences objects, as flash
+// outlives a reboot, and the entry iterator over it. Keys are
+// "<namespace>/<key>", each with the type it was written as.
+
+#include <Arduino.h>
+#include <map>
+#include <vector>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+
+#define NVS_DEFAULT_PART_NAME "nvs"
+#define NVS_KEY_NAME_MAX_SIZE 16
+#define NVS_NS_NAME_MAX_SIZE NVS_KEY_NAME_MAX_SIZE
+
+typedef enum {
+  NVS_TYPE_U8 = 0x01,
+  NVS_TYPE_STR = 0x21,
+  NVS_TYPE_BLOB = 0x42,
+  NVS_TYPE_ANY = 0xff,
+} nvs_type_t;
+
+struct HostNvsEntry {
+  nvs_type_t type;
+  std::vector<uint8_t> value;
+};
+
+inline std::map<std::string, HostNvsEntry> hostNvs;
+
+typedef struct {
+  char namespace_name[NVS_NS_NAME_MAX_SIZE];
+  char key[NVS_KEY_NAME_MAX_SIZE];
+  nvs_type_t type;
+} nvs_entry_info_t;
+
+struct HostNvsIterator {
+  std::string space;
+  nvs_type_t type;
+  std::string at;          // Full key of the current entry
+};
+
+typedef HostNvsIterator *nvs_iterator_t;
+
+// Move it to the first matching entry after full key after (or from the
+// start); frees it and returns not found when there is none
+inline esp_err_t hostNvsSeek(nvs_iterator_t *it, bool after) {
+  nvs_iterator_t i = *it;
+  auto entry = after ? hostNvs.upper_bound(i->at) : hostNvs.lower_bound(i->space);
+  for (; entry != hostNvs.end() && entry->first.compare(0, i->space.size(), i->space) == 0; ++entry) {
+    if (i->type == NVS_TYPE_ANY || entry->second.type == i->type) {
+      i->at = entry->first;
+      return ESP_OK;
+    }
+  }
+  delete i;
+  *it = NULL;
+  return ESP_ERR_NVS_NOT_FOUND;
+}
+
+inline esp_err_t nvs_entry_find(const char *part, const char *space, nvs_type_t type, nvs_iterator_t *it) {
+  HostLibraryCall call;
+  *it = new HostNvsIterator{std::string(space) + "/", type, ""};
+  return hostNvsSeek(it, false);
+}
+
+inline esp_err_t nvs_entry_next(nvs_iterator_t *it) {
+  HostLibraryCall call;
+  return hostNvsSeek(it, true);
+}
+
+inline esp_err_t nvs_entry_info(nvs_iterator_t it, nvs_entry_info_t *info) {
+  HostLibraryCall call;
+  std::string space = it->space.substr(0, it->space.size() - 1);
+  snprintf(info->namespace_name, sizeof(info->namespace_name), "%s", space.c_str());
+  snprintf(info->key, sizeof(info->key), "%s", it->at.c_str() + it->space.size());
+  info->type = hostNvs[it->at].type;
+  return ESP_OK;
+}
+
+inline void nvs_release_iterator(nvs_iterator_t it) {
+  delete it;
+}
+
+#endif
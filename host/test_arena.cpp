@@ -0,0 +1,156 @@
+// Request arena and heap use, request by request. Handlers build their
+// responses in the request arena, so none of them may allocate from the
+// heap; each request's peak arena use is reported against the arena's size.
+// Reading arguments and headers through WebServer's copies counts, as it
+// allocates on the device.
+// Chunked exports (presets, log) reuse one chunk's space, and a chunk that
+// cannot fit drops the connection rather than sending a truncated file.
+// Ghost names come back as valid JSON whatever they contain.
+
+#include "host_test.h"
+#include <new>
+#include <string>
+
+size_t sketchAllocations = 0;
+
+// The replacement pair is malloc/free, which GCC cannot see is matched
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(size_t n) {
+  if (hostSketchHeap) sketchAllocations++;
+  void *p = malloc(n ? n : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+struct Usage {
+  size_t peak;
+  size_t allocations;
+};
+
+// Serve r as loop() would and measure it
+HostResponse serve(const HostRequest &r, Usage &usage) {
+  arenaPeak = 0;
+  size_t allocationsBefore = sketchAllocations;
+  HostResponse response = server.hostServe(r);
+  endRequest();
+  usage.peak = arenaPeak;
+  usage.allocations = sketchAllocations - allocationsBefore;
+  return response;
+}
+
+HostRequest get(const char *uri) {
+  HostRequest r;
+  r.uri = uri;
+  return r;
+}
+
+HostRequest post(const char *uri, const std::string &body) {
+  HostRequest r;
+  r.method = HTTP_POST;
+  r.uri = uri;
+  r.body = body;
+  return r;
+}
+
+void ignoreEvent(JsonStream &json, JsonEvent event, const char *text) {}
+
+bool validJson(const std::string &text) {
+  JsonStream json;
+  jsonBegin(json, ignoreEvent, NULL);
+  jsonFeed(json, text.data(), text.size());
+  return jsonFinish(json);
+}
+
+int main() {
+  bootSketch();
+
+  // Something in every store: presets, a ghost with an awkward name, and a
+  // session log several pages long
+  const char *preset = "{\"name\":\"Tempo\",\"segments\":80,\"pacers\":[{\"enabled\":true,\"time\":75.5,\"color\":\"#00FF00\",\"position\":100}]}";
+  CHECK(request(HTTP_POST, "/preset/save", preset).code == 200);
+
+  const char *ghostName = "Ann \"Q\" \\\n\t";
+  HostRequest ghost = post("/ghost/save", "70.5,71,69.25,68");
+  ghost.args["slot"] = "2";
+  ghost.args["split"] = "400";
+  ghost.args["name"] = ghostName;
+  CHECK(server.hostServe(ghost).code == 200);
+  endRequest();
+
+  CHECK(request(HTTP_POST, "/segments", "SET:80").code == 200);
+  CHECK(request(HTTP_POST, "/command", "START:10,0,#FF0000|11,100,#00FF00|12,200,#0000FF|").code == 200);
+  for (int frame = 0; frame < 10 * 60 * 10; frame++) {
+    clockStep(100 * CLOCK_US_PER_MS);
+    loop();
+  }
+  CHECK(request(HTTP_POST, "/command", "STOP").code == 200);
+
+  HostRequest ghostLoad = get("/ghost/load");
+  ghostLoad.args["slot"] = "2";
+  HostRequest presetLoad = get("/preset/load");
+  presetLoad.args["name"] = "Tempo";
+  HostRequest stale = get("/status");
+  stale.headers["If-None-Match"] = "\"4294967295-stale\"";
+  HostRequest events = get("/events");
+  events.args["since"] = "0";
+
+  struct {
+    const char *name;
+    HostRequest request;
+  } cases[] = {
+    {"GET /status", get("/status")},
+    {"GET /status, stale", stale},
+    {"GET /events", events},
+    {"GET /time", get("/time")},
+    {"GET /lanes", get("/lanes")},
+    {"GET /calibration", get("/calibration")},
+    {"GET /ghost/list", get("/ghost/list")},
+    {"GET /ghost/load", ghostLoad},
+    {"GET /preset/list", get("/preset/list")},
+    {"GET /preset/load", presetLoad},
+    {"GET /presets/export", get("/presets/export")},
+    {"GET /log.csv", get("/log.csv")},
+    {"POST /command", post("/command", "START:60,0,#FF0000|")},
+    {"POST /segments", post("/segments", "SET:80")},
+    {"POST /lanes", post("/lanes", "LANE:0,0,0")},
+    {"POST /preset/save", post("/preset/save", preset)},
+    {"POST /presets/import", post("/presets/import", std::string("[") + preset + "]")},
+  };
+
+  uint32_t overflowsBefore = arenaOverflows;
+  for (auto &c : cases) {
+    Usage usage;
+    HostResponse response = serve(c.request, usage);
+    printf("%-20s %4zu of %d arena bytes, %zu heap allocations, %zu byte response\n",
+           c.name, usage.peak, REQUEST_ARENA_SIZE, usage.allocations, response.body.size());
+    CHECK(response.code == 200 && response.complete);
+    CHECK(usage.allocations == 0);
+    CHECK(usage.peak <= REQUEST_ARENA_SIZE);
+    if (response.contentType == "application/json") CHECK(validJson(response.body));
+  }
+  CHECK(arenaOverflows == overflowsBefore);
+
+  // The log export reuses one chunk's space: its peak is a page, not the file
+  Usage logUsage;
+  HostResponse log = serve(get("/log.csv"), logUsage);
+  CHECK(log.body.size() > 4 * logUsage.peak);
+
+  // Ghost names are escaped, and come back as they went in
+  std::string list = request(HTTP_GET, "/ghost/list").body;
+  CHECK(list == "[{\"slot\":2,\"name\":\"Ann \\\"Q\\\" \\\\\\u000a\\u0009\"}]");
+
+  // A chunk that does not fit drops the connection, without the final chunk
+  for (const char *uri : {"/log.csv", "/presets/export"}) {
+    arenaUsed = REQUEST_ARENA_SIZE - 64;
+    HostResponse cut = server.hostServe(get(uri));
+    endRequest();
+    CHECK(cut.aborted && !cut.complete);
+  }
+  CHECK(arenaOverflows == overflowsBefore + 2);
+
+  return testResult("test_arena");
+}
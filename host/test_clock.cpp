@@ -0,0 +1,126 @@
+// Two-hour session on a stepped clock: every lap event must carry the exact
+// crossing time and split, and the lap counts must come out right at the
+// end. Built twice: on the host's virtual clock, and with -DARDUINO on the
+// widened 32-bit micros() counter, starting just before it wraps so the
+// session crosses the wrap twice.
+
+#include "host_test.h"
+
+#define FRAME_US 16667
+#define SESSION_US (2 * 3600 * CLOCK_US_PER_SEC)
+
+void advance(uint32_t us) {
+#if defined(ARDUINO)
+  hostMicros32 += us;  // Wraps like the hardware counter
+#else
+  clockStep(us);
+#endif
+}
+
+// Laps of the profiled pacer covered t seconds after the start:
+// 120 s at 80 s laps, then 240 s going from 80 s to 64 s laps, then 64 s laps
+double profileLaps(double t) {
+  if (t <= 120) return t / 80;
+
+  double rampT = min(t, 360.0) - 120;
+  double accel = (1.0 / 64 - 1.0 / 80) / 240;
+  double laps = 1.5 + rampT / 80 + 0.5 * accel * rampT * rampT;
+  if (t > 360) laps += (t - 360) / 64;
+  return laps;
+}
+
+// Seconds after the start at which the profiled pacer completes lap laps
+double profileCrossing(int laps) {
+  double low = 0, high = 10 * 3600;
+  for (int k = 0; k < 100; k++) {
+    double mid = (low + high) / 2;
+    if (profileLaps(mid) < laps) low = mid; else high = mid;
+  }
+  return high;
+}
+
+// Expected crossing of lap k by pacer i, microseconds after the start
+double expectedCrossing(int i, int k) {
+  switch (i) {
+    case 0: return k * 72.5e6;
+    case 1: return (k - 0.25) * 61.25e6;  // Starts 100 m into a 400 m lap
+    default: return profileCrossing(k) * 1e6;
+  }
+}
+
+int main() {
+#if defined(ARDUINO)
+  hostMicros32 = 0xFFFFFFFF - 20 * CLOCK_US_PER_SEC;
+#else
+  clockSet(5 * CLOCK_US_PER_SEC);
+#endif
+
+  preferences.begin("trackpacer", false);
+  TOTAL_SEGMENTS = 80;
+  current_NUM_LEDS = TOTAL_SEGMENTS * LOGICAL_UNITS_PER_SEGMENT;
+  loadCalibration();
+  loadLanes();
+  buildBackground();
+  CHECK_NEAR(trackMeters, 400, 1e-3);
+
+  sessionStartTime = trackMicros();
+  parseStartCommand(strView("72.5,0,#FF0000|61.25,100,#00FF00|120:80:80;240:80:64,0,#0000FF|"), sessionStartTime);
+  systemRunning = true;
+  CHECK(pacerHot.count == 3);
+
+  uint32_t seen = 0;
+  int laps[MAX_PACERS] = {0, 0, 0};
+  double lastCrossing[MAX_PACERS] = {0, 0, 0};
+  double worstError[MAX_PACERS] = {0, 0, 0};
+  clock_us_t lastFrame = trackMicros();
+
+  for (clock_us_t t = 0; t < SESSION_US; t += FRAME_US) {
+    advance(FRAME_US);
+    clock_us_t now = trackMicros();
+    updatePacers();
+    renderLEDs();
+
+    for (uint32_t seq = seen + 1; seq <= latestLapEventSeq(); seq++) {
+      LapEvent e;
+      CHECK(readLapEvent(seq, e));
+      int i = e.pacer;
+      int k = ++laps[i];
+      double expected = expectedCrossing(i, k);
+      double actual = (double)(e.timestamp - sessionStartTime);
+      double tolerance = i == 2 ? 20 : 1;  // Profile math is in float
+
+      CHECK(e.lap == (uint32_t)k);
+      CHECK_NEAR(actual, expected, tolerance);
+      CHECK_NEAR(e.splitMicros, expected - lastCrossing[i], 2 * tolerance);
+      CHECK((e.flags & LAP_EVENT_PARTIAL) == (i == 1 && k == 1 ? LAP_EVENT_PARTIAL : 0));
+      // Published in the frame that passed it
+      if (i != 2) CHECK(e.timestamp > lastFrame && e.timestamp <= now);
+
+      worstError[i] = max(worstError[i], fabs(actual - expected));
+      lastCrossing[i] = expected;
+      seen = seq;
+    }
+    lastFrame = now;
+  }
+
+  // 7200 s at 72.5 s laps; at 61.25 s laps from a quarter lap in; and the
+  // profile's 4.875 laps in 6 minutes then 6840 s at 64 s laps
+  CHECK(laps[0] == 99);
+  CHECK(laps[1] == 117);
+  CHECK(laps[2] == 111);
+  for (int i = 0; i < MAX_PACERS; i++) {
+    CHECK(pacerHot.lapCount[pacerHot.slotOf[i]] == (uint32_t)laps[i]);
+  }
+
+#if defined(ARDUINO)
+  CHECK(clockMicros() >> 32 == 2);  // Both wraps were seen
+#endif
+
+  printf("laps %d/%d/%d, worst crossing error %.1f/%.1f/%.1f us\n",
+         laps[0], laps[1], laps[2], worstError[0], worstError[1], worstError[2]);
+#if defined(ARDUINO)
+  return testResult("test_clock_wrap");
+#else
+  return testResult("test_clock");
+#endif
+}
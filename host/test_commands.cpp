@@ -0,0 +1,96 @@
+// Web commands that must be refused rather than half-applied.
+//  - START_AT outside the window from MAX_START_LATE_MS ago to
+//    MAX_START_DELAY_MS ahead.
+//  - Lane geometry that is negative, not finite, or staggered a lap or more.
+//  - A START naming a ghost that is not stored; parsed anyway, such an
+//    entry makes no pacer rather than a 1 s lap one.
+//  - A START with a pacer starting before the line or past its lane's lap.
+//  - A track length change while a ghost runs: its profile is in lap times
+//    for the length it started on.
+
+#include "host_test.h"
+#include <string>
+
+HostResponse startAt(clock_us_t at) {
+  return request(HTTP_POST, "/command", "START_AT:" + std::to_string(at) + ":60,0,#FF0000|");
+}
+
+int main() {
+  clockSet(100 * CLOCK_US_PER_SEC);
+  bootSketch();
+  clock_us_t now = trackMicros();
+
+  CHECK(startAt(0).code == 400);
+  CHECK(startAt(now - 30 * CLOCK_US_PER_SEC).code == 400);
+  CHECK(startAt(now - MAX_START_LATE_MS * CLOCK_US_PER_MS - 1).code == 400);
+  CHECK(startAt(now + MAX_START_DELAY_MS * CLOCK_US_PER_MS + 1).code == 400);
+  CHECK(request(HTTP_POST, "/command", "START_AT:" + std::to_string(now)).code == 400);
+  CHECK(!systemRunning);
+
+  CHECK(startAt(now - MAX_START_LATE_MS * CLOCK_US_PER_MS / 2).code == 200);
+  CHECK(systemRunning && sessionStartTime == now - MAX_START_LATE_MS * CLOCK_US_PER_MS / 2);
+  CHECK(startAt(now + 3 * CLOCK_US_PER_SEC).code == 200);
+  CHECK(sessionStartTime == now + 3 * CLOCK_US_PER_SEC);
+
+  // Lanes, on the default one-segment track
+  float lap = trackMeters;
+  const char *badLanes[] = {"LANE:0,-1,0", "LANE:0,nan,0", "LANE:0,inf,0", "LANE:0,0,-0.5",
+                            "LANE:0,0,nan", "LANE:0,0,inf", "LANE:0,7.5,99", "LANE:9,0,0"};
+  for (const char *lane : badLanes) {
+    CHECK(request(HTTP_POST, "/lanes", lane).code == 400);
+  }
+  CHECK(lanes[0].extraMeters == 0 && lanes[0].staggerMeters == 0);
+
+  std::string edge = "LANE:0,2," + std::to_string(lap + 2 - 0.01);
+  CHECK(request(HTTP_POST, "/lanes", edge).code == 200);
+  CHECK(request(HTTP_POST, "/lanes", "LANE:0,2," + std::to_string(lap + 2)).code == 400);
+  CHECK(lanes[0].extraMeters == 2);
+
+  // Ghosts
+  CHECK(request(HTTP_POST, "/command", "STOP").code == 200);
+  HostRequest ghost;
+  ghost.method = HTTP_POST;
+  ghost.uri = "/ghost/save";
+  ghost.body = "15,16";
+  ghost.args["slot"] = "1";
+  ghost.args["split"] = "5";
+  ghost.args["name"] = "PB";
+  CHECK(server.hostServe(ghost).code == 200);
+  endRequest();
+
+  CHECK(request(HTTP_POST, "/command", "START:60,0,#FF0000|G5,0,#00FF00|").code == 400);
+  CHECK(request(HTTP_POST, "/command", "START:G" + std::to_string(MAX_GHOSTS) + ",0,#00FF00|").code == 400);
+  CHECK(request(HTTP_POST, "/command", "START_AT:" + std::to_string(trackMicros()) + ":G0,0,#00FF00|").code == 400);
+  CHECK(!systemRunning);
+
+  CHECK(request(HTTP_POST, "/command", "START:60,0,#FF0000|G1,0,#00FF00|").code == 200);
+  CHECK(pacerHot.count == 2 && pacers[1].profile.spec.count == 2);
+
+  int segments = TOTAL_SEGMENTS;
+  CHECK(request(HTTP_POST, "/segments", "SET:" + std::to_string(segments + 1)).code == 409);
+  CHECK(request(HTTP_POST, "/calibration", "CAL:5.1").code == 409);
+  CHECK(TOTAL_SEGMENTS == segments && trackMeters == lap);
+  CHECK(request(HTTP_POST, "/segments", "SET:" + std::to_string(segments)).code == 200);
+  CHECK(request(HTTP_POST, "/command", "STOP").code == 200);
+  CHECK(request(HTTP_POST, "/segments", "SET:" + std::to_string(segments + 1)).code == 200);
+  CHECK(TOTAL_SEGMENTS == segments + 1);
+
+  // Start positions, on the lap of the pacer's lane (2 m longer here)
+  int lap0 = (int)(trackMeters + lanes[0].extraMeters);
+  const std::string badStarts[] = {
+      "START:60,-5,#FF0000|", "START:60,0,#FF0000|60," + std::to_string(lap0 + 1) + ",#00FF00|",
+      "START_AT:" + std::to_string(trackMicros()) + ":60,-1,#FF0000|"};
+  for (const std::string &start : badStarts) {
+    CHECK(request(HTTP_POST, "/command", start).code == 400);
+  }
+  CHECK(!systemRunning);
+  CHECK(request(HTTP_POST, "/command", "START:60," + std::to_string(lap0) + ",#FF0000|").code == 200);
+  CHECK(pacerHot.count == 1);
+  CHECK(request(HTTP_POST, "/command", "STOP").code == 200);
+  CHECK(metersToPhase(-2.5, 10) == metersToPhase(7.5, 10));
+
+  parseStartCommand(strView("G6,0,#00FF00|60,0,#FF0000|"), trackMicros());
+  CHECK(pacerHot.count == 1 && pacers[0].timePerLap == 60);
+
+  return testResult("test_commands");
+}
@@ -0,0 +1,141 @@
+// Fifty clients polling /status ten times a second each while a session
+// runs, served through loop() one request per pass as on the device, with
+// one more client changing settings. Polls beyond the shared budget are
+// shed with a 429, control requests are all answered, and the time a loop
+// pass takes (what stands between one frame and the next) stays close to
+// what it is with nobody polling. Most passes have no new frame to draw, as
+// the pacers move a unit every few milliseconds. The same flood with the
+// buckets kept full is reported alongside, for what the limiting saves.
+
+#include "host_test.h"
+#include <algorithm>
+#include <vector>
+
+#define CLIENTS 50
+#define POLL_MS 100
+#define CONTROL_MS 2000
+#define PASS_US 1000                 // Virtual time per loop pass, a millisecond
+#define SECONDS 20
+
+struct Flood {
+  uint32_t served = 0;
+  uint32_t shed = 0;
+  uint32_t control = 0;
+  uint32_t controlFailed = 0;
+  uint32_t controlWaitMax = 0;       // Passes from queueing to answer
+  std::vector<uint64_t> passNs;
+};
+
+uint32_t pass;
+uint32_t controlQueuedAt;
+
+void countResponse(Flood &flood, const HostRequest &request, const HostResponse &response) {
+  if (request.uri == "/status") {
+    if (response.code == 200) flood.served++;
+    else if (response.code == 429) flood.shed++;
+  } else {
+    flood.control++;
+    if (response.code != 200) flood.controlFailed++;
+    flood.controlWaitMax = max(flood.controlWaitMax, pass - controlQueuedAt);
+  }
+}
+
+// Run loop() for SECONDS of virtual time with clients polling (or not),
+// timing every pass
+Flood run(int clients, bool limited) {
+  Flood flood;
+  server.hostOnResponse = [&flood](const HostRequest &request, const HostResponse &response) {
+    countResponse(flood, request, response);
+  };
+
+  uint32_t passes = SECONDS * CLOCK_US_PER_SEC / PASS_US;
+  flood.passNs.reserve(passes);
+
+  for (pass = 0; pass < passes; pass++) {
+    uint32_t ms = pass * PASS_US / CLOCK_US_PER_MS;
+
+    // Each client on its own phase of the poll period
+    for (int c = 0; c < clients; c++) {
+      if ((ms + c * POLL_MS / CLIENTS) % POLL_MS == 0) {
+        HostRequest poll;
+        poll.uri = "/status";
+        poll.clientIp = (uint32_t)IPAddress(192, 168, 4, 10 + c);
+        server.hostQueue(poll);
+      }
+    }
+    if (ms % CONTROL_MS == CONTROL_MS / 2) {
+      HostRequest control;
+      control.method = HTTP_POST;
+      control.uri = "/lanes";
+      control.body = "LANE:0,0,0";
+      control.clientIp = (uint32_t)IPAddress(192, 168, 4, 2);
+      server.hostQueue(control);
+      controlQueuedAt = pass;
+    }
+
+    if (!limited) {
+      pollTokens = POLL_TOTAL_BURST;
+      for (ClientBucket &bucket : clientBuckets) bucket.tokens = POLL_CLIENT_BURST;
+    }
+
+    clockStep(PASS_US);
+    uint64_t start = hostNanos();
+    loop();
+    flood.passNs.push_back(hostNanos() - start);
+  }
+
+  server.hostOnResponse = nullptr;
+  std::sort(flood.passNs.begin(), flood.passNs.end());
+  return flood;
+}
+
+double meanUs(const Flood &flood) {
+  double total = 0;
+  for (uint64_t ns : flood.passNs) total += ns;
+  return total / flood.passNs.size() / 1e3;
+}
+
+double percentileUs(const Flood &flood, int percent) {
+  return flood.passNs[(flood.passNs.size() - 1) * percent / 100] / 1e3;
+}
+
+void report(const char *name, const Flood &flood) {
+  printf("%-22s loop pass mean %5.2f us, median %5.2f us, p99 %5.1f us, worst %7.1f us; "
+         "%5u polls served, %5u shed, %u control (longest wait %u passes)\n",
+         name, meanUs(flood), percentileUs(flood, 50), percentileUs(flood, 99), flood.passNs.back() / 1e3,
+         flood.served, flood.shed, flood.control, flood.controlWaitMax);
+}
+
+int main() {
+  bootSketch();
+  CHECK(request(HTTP_POST, "/segments", "SET:80").code == 200);
+  CHECK(request(HTTP_POST, "/command", "START:72.5,0,#FF0000|61.25,100,#00FF00|80,200,#0000FF|").code == 200);
+
+  Flood quiet = run(0, true);
+  Flood flood = run(CLIENTS, true);
+  Flood unlimited = run(CLIENTS, false);
+
+  report("no clients", quiet);
+  report("50 clients", flood);
+  report("50 clients, no limit", unlimited);
+
+  // Every poll was answered one way or the other, and no more were served
+  // than the shared bucket allows
+  uint32_t polls = CLIENTS * SECONDS * 1000 / POLL_MS;
+  CHECK(flood.served + flood.shed == polls);
+  CHECK(flood.served <= POLL_TOTAL_RATE * SECONDS + POLL_TOTAL_BURST);
+  CHECK(flood.served >= POLL_TOTAL_RATE * SECONDS * 9 / 10);
+  CHECK(unlimited.served == polls);
+
+  // Settings changes all went through, promptly
+  CHECK(flood.control == SECONDS * 1000 / CONTROL_MS && flood.controlFailed == 0);
+  CHECK(flood.controlWaitMax <= 2);
+
+  // The flood costs a loop pass little more than nobody polling: shed
+  // polls are cheap, and the served ones are few
+  CHECK(percentileUs(flood, 99) <= 2 * percentileUs(quiet, 99) + 100);
+  CHECK(percentileUs(flood, 50) <= 2 * percentileUs(quiet, 50) + 20);
+
+  CHECK(server.hostPending() == 0);
+  return testResult("test_flood");
+}
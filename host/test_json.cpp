@@ -0,0 +1,251 @@
+// Streaming JSON parser and preset parsing under hostile input.
+//  - Splitting a document into chunks at any byte, or feeding it a byte at
+//    a time, gives exactly the events, error and error position of parsing
+//    it in one piece.
+//  - Random mutations of valid presets and libraries never crash the
+//    parser (this test is built with the address and undefined-behaviour
+//    sanitizers), never exceed its depth or token limits, and anything
+//    accepted re-serializes to a document that parses the same way. A
+//    preset that is accepted is in range.
+//  - Depth and token limits, \u escapes, arrays in a library and duplicate
+//    keys behave as documented.
+// Usage: test_json [mutations]
+
+#include "host_test.h"
+#include <string>
+#include <vector>
+
+// Event trace: one entry per event, "<event> <depth> <length>:<text>"
+void traceEvent(JsonStream &json, JsonEvent event, const char *text) {
+  std::string &trace = *(std::string*)json.context;
+  CHECK(json.depth <= JSON_MAX_DEPTH);
+  CHECK(strlen(text) < JSON_MAX_TOKEN);
+
+  char head[48];
+  snprintf(head, sizeof(head), "%d %d %zu:", event, json.depth, strlen(text));
+  trace += head;
+  trace += text;
+}
+
+struct Parse {
+  std::string trace;
+  std::string error;
+  size_t position;
+};
+
+// Parse doc fed in chunks ending at each of cuts (ascending), then the rest
+Parse parseChunks(const std::string &doc, const std::vector<size_t> &cuts) {
+  Parse result;
+  JsonStream json;
+  jsonBegin(json, traceEvent, &result.trace);
+
+  size_t at = 0;
+  for (size_t cut : cuts) {
+    jsonFeed(json, doc.data() + at, cut - at);
+    at = cut;
+  }
+  jsonFeed(json, doc.data() + at, doc.size() - at);
+  jsonFinish(json);
+
+  result.error = json.error ? json.error : "";
+  result.position = json.position;
+  CHECK(result.position <= doc.size());
+  return result;
+}
+
+bool sameParse(const Parse &a, const Parse &b) {
+  return a.trace == b.trace && a.error == b.error && a.position == b.position;
+}
+
+// Parse doc whole, split in two at every byte, and a byte at a time; all
+// must agree
+Parse checkSplits(const std::string &doc) {
+  Parse whole = parseChunks(doc, {});
+
+  std::vector<size_t> everyByte;
+  for (size_t i = 1; i < doc.size(); i++) {
+    Parse split = parseChunks(doc, {i});
+    CHECK(sameParse(whole, split));
+    if (!sameParse(whole, split)) fprintf(stderr, "  split at %zu: %s\n", i, doc.c_str());
+    everyByte.push_back(i);
+  }
+  CHECK(sameParse(whole, parseChunks(doc, everyByte)));
+  return whole;
+}
+
+// Turn an accepted trace back into JSON text
+std::string serialize(const std::string &trace) {
+  std::string out;
+  bool needComma = false;
+  size_t at = 0;
+
+  while (at < trace.size()) {
+    int event, depth, length, text;
+    sscanf(trace.c_str() + at, "%d %d %d:%n", &event, &depth, &length, &text);
+    std::string value = trace.substr(at + text, length);
+    at += text + length;
+
+    bool closes = event == JSON_OBJECT_END || event == JSON_ARRAY_END;
+    if (needComma && !closes) out += ',';
+
+    switch (event) {
+      case JSON_OBJECT_START: out += '{'; break;
+      case JSON_OBJECT_END: out += '}'; break;
+      case JSON_ARRAY_START: out += '['; break;
+      case JSON_ARRAY_END: out += ']'; break;
+      case JSON_NUMBER: case JSON_TRUE: case JSON_FALSE: case JSON_NULL: out += value; break;
+      case JSON_KEY: case JSON_STRING: {
+        char buf[JSON_MAX_TOKEN * 6 + 3];
+        TextWriter quoted = textWriter(buf, sizeof(buf));
+        quoted.appendQuoted(value.c_str());
+        out += buf;
+        if (event == JSON_KEY) out += ':';
+        break;
+      }
+    }
+    needComma = event != JSON_KEY && event != JSON_OBJECT_START && event != JSON_ARRAY_START;
+  }
+  return out;
+}
+
+// Parse doc as a single preset and as a library; whatever is accepted must
+// be in range
+void checkPresetParses(const std::string &doc) {
+  JsonStream json;
+  PresetParse preset;
+  jsonBegin(json, presetDocumentEvent, &preset);
+  beginPresetParse(preset, 1);
+  jsonFeed(json, doc.data(), doc.size());
+
+  if (jsonFinish(json) && !presetParseError(preset)) {
+    const PresetRecord &r = preset.record;
+    CHECK(strlen(r.name) > 0 && strlen(r.name) < PRESET_NAME_LEN);
+    CHECK(r.segments >= 1 && r.segments <= MAX_SEGMENTS);
+    CHECK(r.count >= 1 && r.count <= MAX_PACERS);
+    for (int i = 0; i < r.count; i++) {
+      CHECK(r.pacers[i].time > 0 && r.pacers[i].time <= 3600);
+      CHECK(r.pacers[i].position >= 0 && r.pacers[i].position <= MAX_SEGMENTS * 5);
+    }
+  }
+
+  PresetImport import;
+  jsonBegin(json, presetLibraryEvent, &import);
+  beginPresetImport(import);
+  jsonFeed(json, doc.data(), doc.size());
+  if (jsonFinish(json)) CHECK(import.count >= 0 && import.count <= MAX_PRESETS);
+}
+
+uint32_t rngState = 0x2545F491;
+
+uint32_t rng() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+// One random edit: replace, insert or delete a byte, or duplicate a run
+std::string mutate(std::string doc) {
+  static const char interesting[] = "{}[]\",:\\u0123456789.eE+-tfn \x01\xC3\xFF";
+  size_t at = doc.empty() ? 0 : rng() % doc.size();
+  char c = (rng() & 1) ? interesting[rng() % (sizeof(interesting) - 1)] : (char)rng();
+
+  switch (rng() % 4) {
+    case 0: if (!doc.empty()) doc[at] = c; break;
+    case 1: doc.insert(doc.begin() + at, c); break;
+    case 2: if (!doc.empty()) doc.erase(at, 1); break;
+    case 3: {
+      size_t n = rng() % 16;
+      doc.insert(at, doc.substr(at, n));
+      break;
+    }
+  }
+  return doc;
+}
+
+const char *PRESET = "{\"name\":\"Tempo \\u00e9\",\"segments\":80,\"pacers\":["
+                     "{\"enabled\":true,\"time\":72.5,\"color\":\"#FF0000\",\"position\":0},"
+                     "{\"enabled\":false,\"time\":80,\"color\":\"#00ff00\",\"position\":100}]}";
+
+std::string nested(int depth) {
+  return std::string(depth, '[') + std::string(depth, ']');
+}
+
+std::string errorOf(const std::string &doc) {
+  return parseChunks(doc, {}).error;
+}
+
+int main(int argc, char **argv) {
+  int mutations = argc > 1 ? atoi(argv[1]) : 20000;
+  preferences.begin("trackpacer", false);
+
+  // Limits
+  CHECK(errorOf(nested(JSON_MAX_DEPTH)) == "");
+  CHECK(errorOf(nested(JSON_MAX_DEPTH + 1)) == "Nested too deeply");
+  std::string longest(JSON_MAX_TOKEN - 1, 'x');
+  CHECK(errorOf("\"" + longest + "\"") == "");
+  CHECK(errorOf("\"" + longest + "x\"") == "Value too long");
+  CHECK(errorOf("{\"" + longest + "x\":1}") == "Value too long");
+  CHECK(errorOf(std::string(JSON_MAX_TOKEN - 1, '1')) == "");
+  CHECK(errorOf(std::string(JSON_MAX_TOKEN, '1')) == "Value too long");
+
+  // \u escapes decode to UTF-8, and may be split anywhere
+  CHECK(checkSplits("\"\\u0041\\u00e9\\u20AC\"").trace == "5 0 6:A\xC3\xA9\xE2\x82\xAC");
+  CHECK(errorOf("\"\\u12G4\"") == "Bad escape");
+  CHECK(errorOf("\"\\u12\"") == "Bad escape");
+  CHECK(errorOf("\"\\x\"") == "Bad escape");
+  // Each escape counts as its UTF-8 length against the token limit
+  std::string euros;
+  for (int i = 0; i <= JSON_MAX_TOKEN / 3; i++) euros += "\\u20AC";
+  CHECK(errorOf("\"" + euros + "\"") == "Value too long");
+
+  // Arrays where a library needs presets, and duplicate keys (the last wins)
+  const char *libraries[] = {"[[1]]", "[[\"x\"]]", "[[]]", "[1]", "[null]"};
+  for (const char *library : libraries) {
+    JsonStream json;
+    PresetImport import;
+    jsonBegin(json, presetLibraryEvent, &import);
+    beginPresetImport(import);
+    jsonFeed(json, library, strlen(library));
+    CHECK(!jsonFinish(json));
+  }
+
+  JsonStream json;
+  PresetParse preset;
+  const char *duplicated = "{\"name\":\"A\",\"name\":\"B\",\"segments\":4,\"pacers\":[{\"time\":60}],\"pacers\":[{\"time\":70},{\"time\":71}]}";
+  jsonBegin(json, presetDocumentEvent, &preset);
+  beginPresetParse(preset, 1);
+  jsonFeed(json, duplicated, strlen(duplicated));
+  CHECK(jsonFinish(json) && !presetParseError(preset));
+  CHECK(strcmp(preset.record.name, "B") == 0);
+  CHECK(preset.record.count == 2);
+  CHECK(preset.record.pacers[0].time == 70);
+
+  // Splits and round trips of the seeds
+  std::string library = std::string("[") + PRESET + "," + PRESET + "]";
+  std::vector<std::string> seeds = {PRESET, library, nested(JSON_MAX_DEPTH), "[1,-2.5e3,true,false,null,\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"]"};
+  for (const std::string &seed : seeds) {
+    Parse parse = checkSplits(seed);
+    CHECK(parse.error == "");
+    CHECK(parseChunks(serialize(parse.trace), {}).trace == parse.trace);
+  }
+
+  // Mutations, stacked up to eight deep
+  int accepted = 0;
+  for (int n = 0; n < mutations; n++) {
+    std::string doc = seeds[rng() % 2];
+    int edits = 1 + rng() % 8;
+    for (int k = 0; k < edits; k++) doc = mutate(doc);
+
+    Parse parse = n % 16 == 0 ? checkSplits(doc) : parseChunks(doc, {rng() % (doc.size() + 1)});
+    if (n % 16 != 0) CHECK(sameParse(parse, parseChunks(doc, {})));
+    if (parse.error.empty()) {
+      accepted++;
+      CHECK(parseChunks(serialize(parse.trace), {}).trace == parse.trace);
+    }
+    checkPresetParses(doc);
+  }
+
+  printf("%d mutations, %d still valid JSON\n", mutations, accepted);
+  return testResult("test_json");
+}
@@ -0,0 +1,69 @@
+// Track markings show only while a session runs. The strip is dark at boot,
+// after settings changes between sessions and after STOP; a START, a
+// resumed session or a leader's start lights them, and a leader's stop
+// takes them away again.
+
+#include "host_test.h"
+
+bool dark() {
+  for (int l = 0; l < NUM_LANES; l++) {
+    for (int i = 0; i < MAX_LOGICAL_LEDS; i++) {
+      if (leds[l][i] != CRGB(0, 0, 0)) return false;
+    }
+  }
+  return true;
+}
+
+// The finish line, clear of the pacers, which start at 300 m, off the
+// 500 units this controller drives
+bool marked() {
+  return leds[0][0] == CRGB(START_LINE_COLOR);
+}
+
+// A leader's packet for the current pacers
+void leaderPacket(bool running, uint32_t configGen) {
+  SyncPacket packet = {};
+  packet.magic = SYNC_MAGIC;
+  packet.configGen = configGen;
+  packet.trackTime = trackMicros();
+  packet.sessionStart = sessionStartTime;
+  packet.running = running;
+  packet.segments = TOTAL_SEGMENTS;
+  for (int i = 0; i < MAX_PACERS; i++) packPacerConfig(pacers[i], packet.pacers[i]);
+  applySyncPacket(packet, clockMicros());
+}
+
+int main() {
+  bootSketch();
+  CHECK(dark());
+
+  CHECK(request(HTTP_POST, "/segments", "SET:80").code == 200);
+  CHECK(request(HTTP_POST, "/lanes", "LANE:0,0,0").code == 200);
+  CHECK(dark());
+
+  CHECK(request(HTTP_POST, "/command", "START:60,300,#FF0000|").code == 200);
+  CHECK(marked());
+
+  CHECK(request(HTTP_POST, "/command", "STOP").code == 200);
+  CHECK(dark());
+
+  // A session resumed after a reboot, onto a dark strip
+  CHECK(request(HTTP_POST, "/command", "START:60,300,#FF0000|").code == 200);
+  systemRunning = false;
+  resetFrame();
+  CHECK(restoreSession());
+  CHECK(marked());
+
+  // A follower following the leader into and out of a session
+  CHECK(request(HTTP_POST, "/command", "STOP").code == 200);
+  leaderPacket(false, 100);
+  CHECK(dark());
+  leaderPacket(true, 101);
+  CHECK(marked());
+  leaderPacket(true, 101);
+  CHECK(marked());
+  leaderPacket(false, 101);
+  CHECK(dark());
+
+  return testResult("test_markings");
+}
@@ -0,0 +1,166 @@
+// Ownership of the output buffers. FastLED.show() stands in for a transfer
+// of TRANSFER_US on the output task, and checks at both ends that ledOut[]
+// holds one whole frame, untouched in between, while the output is busy.
+// Meanwhile the loop keeps drawing into leds[] and offering frames, which
+// submitFrame() must turn away until the task gives outputFree back. The
+// frames sent must be the ones submitFrame() took, in order, and the loop
+// must never wait for a transfer. First, one frame is held on the wire
+// while the next is offered.
+
+#include "host_test.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#define TRANSFER_US 2000
+#define FRAMES 200
+
+std::atomic<int> framesSent{0};
+std::atomic<int> framesTorn{0};       // Mixed, or changed while being sent
+std::atomic<int> framesNotBusy{0};    // Sent with the output already free
+int sentFrames[FRAMES];               // Frame number each transfer carried
+
+// Each test frame is one color throughout, from its number
+CRGB frameColor(int frame) {
+  return CRGB(frame >> 16, frame >> 8, frame);
+}
+
+int colorFrame(const CRGB &color) {
+  return (color.r << 16) | (color.g << 8) | color.b;
+}
+
+// Whether every registered output holds color
+bool outputsHold(const CRGB &color) {
+  for (int o = 0; o < FastLED.outputCount; o++) {
+    for (int i = 0; i < FastLED.outputs[o].count; i++) {
+      if (FastLED.outputs[o].pixels[i] != color) return false;
+    }
+  }
+  return true;
+}
+
+void fillFrame(int frame) {
+  for (int l = 0; l < NUM_LANES; l++) fill_solid(leds[l], MAX_LOGICAL_LEDS, frameColor(frame));
+}
+
+void sendTestFrame() {
+  CRGB color = FastLED.outputs[0].pixels[0];
+  bool whole = outputsHold(color);
+  std::this_thread::sleep_for(std::chrono::microseconds(TRANSFER_US));
+  if (!whole || !outputsHold(color)) framesTorn++;
+  if (!outputBusy()) framesNotBusy++;
+  if (framesSent < FRAMES) sentFrames[framesSent] = colorFrame(color);
+  framesSent++;
+}
+
+// A sketch frame is not one color; it must not change while being sent
+void sendSketchFrame() {
+  static CRGB sending[NUM_LANES][MAX_LOGICAL_LEDS];
+  memcpy(sending, ledOut, sizeof(sending));
+  std::this_thread::sleep_for(std::chrono::microseconds(TRANSFER_US));
+  if (memcmp(sending, ledOut, sizeof(sending)) != 0) framesTorn++;
+  if (!outputBusy()) framesNotBusy++;
+  framesSent++;
+}
+
+// A frame held on the wire until released
+std::atomic<bool> holding{false};
+std::atomic<bool> release{false};
+
+void holdFrame() {
+  holding = true;
+  while (!release) std::this_thread::yield();
+  holding = false;
+}
+
+// Submit frame 1, then offer frame 2 while 1 is still being sent
+void submitWhileSending() {
+  hostShowHook = holdFrame;
+  fillFrame(1);
+  CHECK(submitFrame());
+  while (!holding) std::this_thread::yield();
+
+  fillFrame(2);
+  CHECK(outputBusy());
+  CHECK(!submitFrame());
+  CHECK(outputsHold(frameColor(1)));
+
+  // Once 1 is out, 2 goes
+  release = true;
+  waitFrameShown();
+  CHECK(!outputBusy());
+  release = false;
+  CHECK(submitFrame());
+  while (!holding) std::this_thread::yield();
+  CHECK(outputsHold(frameColor(2)));
+  release = true;
+  waitFrameShown();
+  hostShowHook = nullptr;
+}
+
+int main() {
+  bootSketch();
+
+  // FastLED sends ledOut[], never leds[]
+  CHECK(FastLED.outputCount == NUM_LANES);
+  for (int l = 0; l < NUM_LANES; l++) CHECK(FastLED.outputs[l].pixels == ledOut[l]);
+
+  submitWhileSending();
+
+  // Offer a new frame as fast as one can be drawn
+  hostShowHook = sendTestFrame;
+  std::vector<int> taken;
+  int offered = 0, refused = 0;
+  for (int frame = 1; framesSent < FRAMES; frame++) {
+    fillFrame(frame);
+    offered++;
+
+    bool busy = outputBusy();
+    if (submitFrame()) {
+      taken.push_back(frame);
+    } else {
+      CHECK(busy);
+      refused++;
+    }
+  }
+  waitFrameShown();
+
+  printf("%d frames offered, %d sent, %d refused while sending, %d torn\n",
+         offered, framesSent.load(), refused, framesTorn.load());
+  CHECK(framesTorn == 0 && framesNotBusy == 0);
+  CHECK(refused > 0 && offered == (int)taken.size() + refused);
+  CHECK((int)taken.size() == framesSent);
+  for (int i = 0; i < FRAMES && i < (int)taken.size(); i++) CHECK(sentFrames[i] == taken[i]);
+
+  // Through loop(), in real time: a session drawing a new frame every few
+  // milliseconds. The loop goes on drawing and serving while each frame is
+  // sent, and submits the newest one once the last has gone.
+  framesSent = 0;
+  hostShowHook = sendSketchFrame;
+  clockSetScale(1.0);
+
+  CHECK(request(HTTP_POST, "/segments", "SET:80").code == 200);
+  CHECK(request(HTTP_POST, "/command", "START:8,0,#FF0000|9,100,#00FF00|10,200,#0000FF|").code == 200);
+
+  std::vector<uint64_t> passNs;
+  int passesWhileSending = 0;
+  while (framesSent < FRAMES) {
+    if (outputBusy()) passesWhileSending++;
+    uint64_t start = hostNanos();
+    loop();
+    passNs.push_back(hostNanos() - start);
+  }
+  waitFrameShown();
+  hostShowHook = nullptr;
+
+  std::sort(passNs.begin(), passNs.end());
+  double p99 = passNs[passNs.size() * 99 / 100] / 1e3;
+  printf("loop: %zu passes, %d while a frame was being sent, p99 %.1f us against a %d us transfer\n",
+         passNs.size(), passesWhileSending, p99, TRANSFER_US);
+  CHECK(framesTorn == 0 && framesNotBusy == 0);
+  CHECK(passesWhileSending > 0);
+  CHECK(p99 < TRANSFER_US / 4);
+
+  return testResult("test_output");
+}
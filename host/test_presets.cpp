@@ -0,0 +1,90 @@
+// Presets through the web handlers. Presets saved in the old format, JSON
+// strings under "preset_<name>", are moved into the library on first use,
+// once. A library import that is not an array of preset objects must be
+// rejected and leave the saved presets as they were; a good one replaces
+// them.
+
+#include "host_test.h"
+
+const char *PRESET_A = "{\"name\":\"Easy\",\"segments\":80,\"pacers\":[{\"enabled\":true,\"time\":90,\"color\":\"#FF0000\",\"position\":0}]}";
+const char *PRESET_B = "{\"name\":\"Tempo\",\"segments\":80,\"pacers\":[{\"enabled\":true,\"time\":75.5,\"color\":\"#00FF00\",\"position\":100}]}";
+
+std::string presetList() {
+  return request(HTTP_GET, "/preset/list").body;
+}
+
+std::string loadPreset(const char *name) {
+  HostRequest load;
+  load.uri = "/preset/load";
+  load.args["name"] = name;
+  std::string body = server.hostServe(load).body;
+  endRequest();
+  return body;
+}
+
+int main() {
+  bootSketch();
+
+  // As the old firmware saved them; one no longer parses
+  Preferences old;
+  old.begin(PREFS_NAMESPACE);
+  old.putString("preset_Old", "{\"segments\":40,\"pacers\":[{\"enabled\":true,\"time\":72.5,\"color\":\"#FF0000\",\"position\":100},"
+                              "{\"enabled\":false,\"time\":10,\"color\":\"#00FF00\",\"position\":0}]}");
+  old.putString("preset_Interval", "{\"segments\":80,\"pacers\":[{\"enabled\":true,\"time\":64,\"color\":\"#0000FF\",\"position\":0}]}");
+  old.putString("preset_Bad", "{\"segments\":80,\"pacers\":[");
+
+  CHECK(presetList() == "[\"Interval\",\"Old\"]");
+  std::string migrated = loadPreset("Old");
+  CHECK(migrated.find("\"name\":\"Old\",\"segments\":40") != std::string::npos);
+  CHECK(migrated.find("{\"enabled\":true,\"time\":72.50,\"color\":\"#FF0000\",\"position\":100}") != std::string::npos);
+  CHECK(migrated.find("{\"enabled\":false,\"time\":10.00") != std::string::npos);
+  CHECK(!old.isKey("preset_Old") && !old.isKey("preset_Interval") && old.isKey("preset_Bad"));
+
+  // Only once: a preset in the old format from now on is not the library's
+  old.putString("preset_Late", "{\"segments\":80,\"pacers\":[{\"time\":60}]}");
+  presetBank = -1;
+  CHECK(presetList() == "[\"Interval\",\"Old\"]");
+  CHECK(request(HTTP_POST, "/preset/delete", "Old").code == 200);
+  CHECK(request(HTTP_POST, "/preset/delete", "Interval").code == 200);
+  CHECK(presetList() == "[]");
+
+  CHECK(request(HTTP_POST, "/preset/save", PRESET_A).code == 200);
+  CHECK(request(HTTP_POST, "/preset/save", PRESET_B).code == 200);
+  std::string saved = presetList();
+  CHECK(saved == "[\"Easy\",\"Tempo\"]");
+
+  const char *bad[] = {
+    "[[1]]",
+    "[[\"x\"]]",
+    "[[]]",
+    "[1]",
+    "[\"x\"]",
+    "[null]",
+    "{}",
+    "[{\"name\":\"Ok\",\"segments\":4,\"pacers\":[{\"time\":60}]},[1]]",
+    "[{\"name\":\"Ok\",\"segments\":4,\"pacers\":[{\"time\":60}]},{\"name\":\"NoPacers\",\"segments\":4}]",
+    "[{\"name\":\"Ok\",\"segments\":4,\"pacers\":[{\"time\":60}]}",
+  };
+
+  for (const char *library : bad) {
+    HostResponse response = request(HTTP_POST, "/presets/import", library);
+    CHECK(response.code == 400);
+    if (response.code != 400) fprintf(stderr, "  accepted: %s\n", library);
+    CHECK(presetList() == saved);
+  }
+
+  // A duplicate name keeps the later preset, and a duplicate key the later value
+  std::string library = std::string("[") + PRESET_A + "," +
+      "{\"name\":\"Easy\",\"segments\":8,\"segments\":40,\"pacers\":[{\"time\":88,\"time\":86}]}]";
+  CHECK(request(HTTP_POST, "/presets/import", library).code == 200);
+  CHECK(presetList() == "[\"Easy\"]");
+  std::string easy = loadPreset("Easy");
+  CHECK(easy.find("\"segments\":40") != std::string::npos);
+  CHECK(easy.find("\"time\":86.00") != std::string::npos);
+
+  // An empty library is a valid way to clear every preset
+  CHECK(request(HTTP_POST, "/presets/import", "[]").code == 200);
+  CHECK(presetList() == "[]");
+
+  return testResult("test_presets");
+}
@@ -0,0 +1,75 @@
+// A session resumed after a reset. The clocks start again from boot, but
+// the session time checkpointed in RTC memory puts the pacers back where
+// they were, with the laps they had run: the next crossing is the next lap,
+// and none already published goes out again. A reset during a START_AT
+// countdown resumes the countdown with the time it had left.
+
+#include "host_test.h"
+
+// The board resetting and booting again: only RTC memory and NVS remain
+void reset() {
+  systemRunning = false;
+  for (int i = 0; i < MAX_PACERS; i++) pacers[i].enabled = false;
+  activatePacers(true);
+  clockSet(2 * CLOCK_US_PER_SEC);
+  setTrackClockOffset(0);
+  CHECK(restoreSession());
+}
+
+void runFor(clock_us_t us) {
+  for (clock_us_t t = 0; t < us; t += 100 * CLOCK_US_PER_MS) {
+    clockStep(100 * CLOCK_US_PER_MS);
+    loop();
+  }
+}
+
+int main() {
+  clockSet(50 * CLOCK_US_PER_SEC);
+  bootSketch();
+  CHECK(request(HTTP_POST, "/segments", "SET:80").code == 200);
+
+  // 60 s laps, two and a half of them run
+  CHECK(request(HTTP_POST, "/command", "START:60,0,#FF0000|").code == 200);
+  runFor(150 * CLOCK_US_PER_SEC);
+  CHECK(latestLapEventSeq() == 2 && pacerHot.lapCount[0] == 2);
+  uint32_t phase = pacerHot.phase[0];
+
+  reset();
+  CHECK(pacerHot.lapCount[0] == 2);
+  loop();
+  CHECK(latestLapEventSeq() == 2);
+  CHECK_NEAR(pacerHot.phase[0], phase, 0x10);
+
+  runFor(40 * CLOCK_US_PER_SEC);
+  LapEvent lap;
+  CHECK(latestLapEventSeq() == 3 && readLapEvent(3, lap));
+  CHECK(lap.lap == 3 && !(lap.flags & LAP_EVENT_PARTIAL));
+  CHECK_NEAR(lap.splitMicros, 60 * CLOCK_US_PER_SEC, 1);
+  CHECK(request(HTTP_POST, "/command", "STOP").code == 200);
+
+  // A countdown 10 s long, reset with 7 s to go
+  clock_us_t startAt = trackMicros() + 10 * CLOCK_US_PER_SEC;
+  CHECK(request(HTTP_POST, "/command", "START_AT:" + std::to_string(startAt) + ":60,100,#00FF00|").code == 200);
+  runFor(3 * CLOCK_US_PER_SEC);
+  uint32_t seq = latestLapEventSeq();
+
+  reset();
+  CHECK_NEAR((int64_t)(sessionStartTime - trackMicros()), 7 * CLOCK_US_PER_SEC, 1);
+  runFor(6 * CLOCK_US_PER_SEC);
+  CHECK(pacerHot.phase[0] == pacerHot.startPhase[0]);
+  runFor(2 * CLOCK_US_PER_SEC);
+  CHECK(pacerHot.phase[0] > pacerHot.startPhase[0]);
+
+  // The first crossing is a partial lap of 300 m from the start
+  runFor(45 * CLOCK_US_PER_SEC);
+  CHECK(latestLapEventSeq() == seq + 1 && readLapEvent(seq + 1, lap));
+  CHECK(lap.lap == 1 && (lap.flags & LAP_EVENT_PARTIAL));
+  CHECK_NEAR(lap.timestamp, sessionStartTime + 45 * CLOCK_US_PER_SEC, 1);
+
+  // Without the RTC copy (power lost), the pacers start over from NVS
+  rtcSession.magic = 0;
+  reset();
+  CHECK(pacerHot.lapCount[0] == 0 && pacerHot.phase[0] == pacerHot.startPhase[0]);
+
+  return testResult("test_resume");
+}
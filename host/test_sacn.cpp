@@ -0,0 +1,166 @@
+// E1.31 output checked by a receiver stand-in on the loopback network.
+// Built with 8 lanes and sACN on, so the controller sends 4000 units as 24
+// universes. The receiver parses every datagram by the standard's byte
+// offsets (not the sketch's struct) and checks each layer's length against
+// what arrived, the value count, per-universe sequence numbers and that
+// the pixels match the frame. Then every pixel is changed every frame for
+// a throughput run, which must lose nothing.
+
+#include "host_test.h"
+
+#define FRAME_US 16667
+#define THROUGHPUT_FRAMES 600
+
+static_assert(SACN_UNIVERSES == 24, "Build with -DNUM_LANES=8");
+
+uint16_t read16(const uint8_t *p) { return (p[0] << 8) | p[1]; }
+uint32_t read32(const uint8_t *p) { return ((uint32_t)read16(p) << 16) | read16(p + 2); }
+
+// A socket can join 20 groups, so universes are spread over several
+#define RECEIVER_SOCKETS 2
+
+struct SacnReceiver {
+  WiFiUDP udp[RECEIVER_SOCKETS];
+  uint8_t packet[1500];
+  int size;
+  uint8_t lastSequence[SACN_FIRST_UNIVERSE + SACN_UNIVERSES];
+  bool seen[SACN_FIRST_UNIVERSE + SACN_UNIVERSES];
+  uint32_t received = 0;
+  uint32_t invalid = 0;
+  uint32_t outOfOrder = 0;
+
+  void begin() {
+    for (int k = 0; k < RECEIVER_SOCKETS; k++) udp[k].begin(SACN_PORT);
+    for (int u = SACN_FIRST_UNIVERSE; u < SACN_FIRST_UNIVERSE + SACN_UNIVERSES; u++) {
+      CHECK(udp[u % RECEIVER_SOCKETS].joinGroup(IPAddress(239, 255, u >> 8, u & 0xFF)));
+      seen[u] = false;
+    }
+  }
+
+  // A well-formed E1.31 data packet for one of our universes; its universe
+  int check() {
+    const uint8_t *p = packet;
+    if (size < 126 || size > 638) return 0;
+    if (read16(p) != 0x0010 || read16(p + 2) != 0 || memcmp(p + 4, "ASC-E1.17\0\0\0", 12) != 0) return 0;
+    // Each layer's flags and length run to the end of the datagram
+    if (read16(p + 16) != (0x7000 | (size - 16)) || read32(p + 18) != 0x00000004) return 0;
+    if (read16(p + 38) != (0x7000 | (size - 38)) || read32(p + 40) != 0x00000002) return 0;
+    if (read16(p + 115) != (0x7000 | (size - 115)) || p[117] != 0x02 || p[118] != 0xA1) return 0;
+    if (read16(p + 119) != 0 || read16(p + 121) != 1) return 0;
+    // Property values: the start code and the slots, exactly what was sent
+    if (read16(p + 123) != size - 125 || p[125] != 0) return 0;
+
+    int universe = read16(p + 113);
+    if (universe < SACN_FIRST_UNIVERSE || universe >= SACN_FIRST_UNIVERSE + SACN_UNIVERSES) return 0;
+    return universe;
+  }
+
+  // Read every waiting packet; onPacket(universe, slots, count) for each
+  template<typename Op>
+  void drain(Op onPacket) {
+    for (int k = 0; k < RECEIVER_SOCKETS; k++) {
+      while ((size = udp[k].parsePacket()) > 0) {
+        udp[k].read(packet, sizeof(packet));
+        take(onPacket);
+      }
+    }
+  }
+
+  template<typename Op>
+  void take(Op onPacket) {
+    received++;
+
+    int universe = check();
+    if (!universe) {
+      invalid++;
+      return;
+    }
+
+    uint8_t sequence = packet[111];
+    if (seen[universe] && sequence != (uint8_t)(lastSequence[universe] + 1)) outOfOrder++;
+    seen[universe] = true;
+    lastSequence[universe] = sequence;
+
+    onPacket(universe, packet + 126, size - 126);
+  }
+};
+
+// The slots of universe u as they should be, from the frame in leds[]
+bool matchesFrame(int universe, const uint8_t *slots, int count) {
+  int u = universe - SACN_FIRST_UNIVERSE;
+  int lane = u / SACN_UNIVERSES_PER_LANE;
+  int first = (u % SACN_UNIVERSES_PER_LANE) * SACN_PIXELS_PER_UNIVERSE;
+  int pixels = min(SACN_PIXELS_PER_UNIVERSE, MAX_LOGICAL_LEDS - first);
+
+  return count == SACN_PIXELS_PER_UNIVERSE * 3 && memcmp(slots, &leds[lane][first], pixels * 3) == 0;
+}
+
+int main() {
+  bootSketch();
+  SacnReceiver receiver;
+  receiver.begin();
+
+  // 50 m per lane is 500 units: the whole of every lane's buffer
+  CHECK(request(HTTP_POST, "/segments", "SET:10").code == 200);
+  CHECK(request(HTTP_POST, "/command", "START:8,0,#FF0000,0,5|9,20,#00FF00,3,5|10,40,#0000FF,7,5|").code == 200);
+
+  uint32_t sentBefore = sacnUniversesSent;
+  int mismatched = 0;
+  for (int frame = 0; frame < 300; frame++) {
+    clockStep(FRAME_US);
+    loop();
+    waitFrameShown();
+    receiver.drain([&](int universe, const uint8_t *slots, int count) {
+      if (!matchesFrame(universe, slots, count)) mismatched++;
+    });
+  }
+  CHECK(sacnUniversesSent > sentBefore);
+  CHECK(receiver.received == sacnUniversesSent - sentBefore);
+  CHECK(receiver.invalid == 0);
+  CHECK(receiver.outOfOrder == 0);
+  CHECK(mismatched == 0);
+
+  // Stopped, every universe is still resent once a second
+  CHECK(request(HTTP_POST, "/command", "STOP").code == 200);
+  for (int pass = 0; pass < 3; pass++) {
+    clockStep(SHOW_KEEPALIVE_MS * CLOCK_US_PER_MS);
+    loop();
+    waitFrameShown();
+  }
+  uint32_t resent = 0;
+  receiver.drain([&](int universe, const uint8_t *slots, int count) { resent++; });
+  CHECK(resent >= SACN_UNIVERSES);
+
+  // Throughput: every pixel of all 4000 units changes every frame
+  uint32_t receivedBefore = receiver.received;
+  uint64_t sendNanos = 0, worstNanos = 0;
+  for (int frame = 0; frame < THROUGHPUT_FRAMES; frame++) {
+    for (int lane = 0; lane < NUM_LANES; lane++) {
+      fill_solid(leds[lane], MAX_LOGICAL_LEDS, CRGB(frame, lane, 255 - frame));
+    }
+    clockStep(FRAME_US);
+
+    uint64_t start = hostNanos();
+    sendSacn();
+    uint64_t spent = hostNanos() - start;
+    sendNanos += spent;
+    worstNanos = max(worstNanos, spent);
+
+    receiver.drain([&](int universe, const uint8_t *slots, int count) {
+      if (!matchesFrame(universe, slots, count)) mismatched++;
+    });
+  }
+
+  uint32_t got = receiver.received - receivedBefore;
+  CHECK(got == THROUGHPUT_FRAMES * SACN_UNIVERSES);
+  CHECK(mismatched == 0);
+  CHECK(receiver.invalid == 0);
+  CHECK(receiver.outOfOrder == 0);
+
+  double seconds = THROUGHPUT_FRAMES * FRAME_US / 1e6;
+  printf("4000 units: %u/%u universes received, %.0f packets/s and %.0f kB/s at 60 fps, "
+         "send %.0f us per frame (worst %.0f us)\n",
+         got, THROUGHPUT_FRAMES * SACN_UNIVERSES, got / seconds, got * SACN_PACKET_BYTES / seconds / 1000,
+         sendNanos / 1e3 / THROUGHPUT_FRAMES, worstNanos / 1e3);
+  return testResult("test_sacn");
+}
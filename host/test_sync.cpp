@@ -0,0 +1,147 @@
+// Leader and followers over the loopback network, in real time. Built twice:
+// as the leader (test_sync), which starts a session and launches the
+// followers (test_sync_follower), each on a clock that drifts from the
+// leader's by a different amount. A follower knows where the leader's clock
+// is on the shared steady clock, so it can measure its own phase error
+// against the truth, and it checks that its track clock never steps
+// backwards: between loop passes it may run slow by the slew limit, no more.
+// Usage: test_sync [seconds]
+
+#include "host_test.h"
+#include <chrono>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define SETTLE_MS 1000
+
+const int DRIFT_PPM[] = {300, -300, 600};
+#define FOLLOWERS (int)(sizeof(DRIFT_PPM) / sizeof(DRIFT_PPM[0]))
+
+int64_t steadyNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#if SYNC_ROLE == SYNC_ROLE_LEADER
+
+int main(int argc, char **argv) {
+  int seconds = argc > 1 ? atoi(argv[1]) : 6;
+
+  clockSet(7 * CLOCK_US_PER_SEC);
+  clockSetScale(1.0);
+  int64_t leaderEpoch = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      virtualClock.anchorReal.time_since_epoch()).count() - (int64_t)virtualClock.anchorVirtual * 1000;
+  bootSketch();
+
+  std::string follower = argv[0];
+  follower = follower.substr(0, follower.rfind('/') + 1) + "test_sync_follower";
+  pid_t children[FOLLOWERS];
+  for (int i = 0; i < FOLLOWERS; i++) {
+    std::string epoch = std::to_string(leaderEpoch), drift = std::to_string(DRIFT_PPM[i]);
+    std::string duration = std::to_string(seconds);
+    children[i] = fork();
+    if (children[i] == 0) {
+      execl(follower.c_str(), follower.c_str(), epoch.c_str(), drift.c_str(), duration.c_str(), (char*)NULL);
+      _exit(127);
+    }
+  }
+
+  // 6.67 m/s around 400 m, from three places
+  CHECK(request(HTTP_POST, "/segments", "SET:80").code == 200);
+  CHECK(request(HTTP_POST, "/calibration", "CAL:5.1234,4.9").code == 200);
+  CHECK(request(HTTP_POST, "/lanes", "LANE:0,0,12.5").code == 200);
+  delay(200);
+  CHECK(request(HTTP_POST, "/command", "START:60,0,#FF0000|60,100,#00FF00|60,250,#0000FF|").code == 200);
+
+  int64_t end = steadyNanos() + (seconds + 1) * 1000000000LL;
+  while (steadyNanos() < end) {
+    loop();
+    delay(1);
+  }
+
+  for (int i = 0; i < FOLLOWERS; i++) {
+    int status;
+    waitpid(children[i], &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+  return testResult("test_sync");
+}
+
+#else
+
+int main(int argc, char **argv) {
+  if (argc < 4) return 2;
+  int64_t leaderEpoch = atoll(argv[1]);
+  int drift = atoi(argv[2]);
+  int seconds = atoi(argv[3]);
+
+  // Each follower's local clock is somewhere else entirely, and drifting
+  clockSet((uint64_t)(1000 + drift) * 1000 * CLOCK_US_PER_SEC);
+  clockSetScale(1.0 + drift * 1e-6);
+  bootSketch();
+
+  int64_t begin = steadyNanos();
+  int64_t end = begin + seconds * 1000000000LL;
+  int samples = 0;
+  double sumError = 0, worstError = 0;
+  int clockSteps = 0, headSteps = 0;
+  clock_us_t lastLocal = 0, lastTrack = 0;
+  uint32_t lastPhase[MAX_PACERS];
+  bool measuring = false;
+
+  while (steadyNanos() < end) {
+    loop();
+
+    int64_t before = steadyNanos();
+    clock_us_t local = clockMicros();
+    clock_us_t track = local + trackClockOffset - trackClockSlewed(local);  // trackMicros() at local
+    int64_t after = steadyNanos();
+    if (!systemRunning || pacerHot.count == 0 || before - begin < SETTLE_MS * 1000000LL) {
+      delay(1);
+      continue;
+    }
+
+    double truth = ((before + after) / 2 - leaderEpoch) / 1e3;
+    double error = (double)track - truth;
+    samples++;
+    sumError += fabs(error);
+    worstError = max(worstError, fabs(error));
+
+    if (measuring) {
+      // Slower than the slew allows (less rounding) is a step back
+      double minimum = (double)(local - lastLocal) * (1e6 - SYNC_MAX_SLEW_PPM) / 1e6 - 2;
+      if ((double)(track - lastTrack) < minimum) {
+        clockSteps++;
+        fprintf(stderr, "  step: track %+lld us in %llu us\n", (long long)(track - lastTrack), (unsigned long long)(local - lastLocal));
+      }
+      for (int s = 0; s < pacerHot.count; s++) {
+        uint32_t moved = (pacerHot.phase[s] - lastPhase[s]) & 0xFFFF;
+        if (moved >= 0x8000) headSteps++;
+      }
+    }
+    measuring = true;
+    lastLocal = local;
+    lastTrack = track;
+    for (int s = 0; s < pacerHot.count; s++) lastPhase[s] = pacerHot.phase[s];
+    delay(1);
+  }
+
+  // Phase error as distance at the pacers' 400 m / 60 s
+  double metersPerUs = 400.0 / 60e6;
+  printf("follower %+d ppm: %d samples, phase error mean %.0f us (%.1f mm), worst %.0f us (%.1f mm), "
+         "track clock stepped back %d times, heads moved back %d times\n",
+         drift, samples, sumError / max(samples, 1), sumError / max(samples, 1) * metersPerUs * 1000,
+         worstError, worstError * metersPerUs * 1000, clockSteps, headSteps);
+
+  CHECK(samples > 0);
+  CHECK(pacerHot.count == 3 && pacers[1].timePerLap == 60 && pacers[1].startPosition == 100);
+  CHECK(TOTAL_SEGMENTS == 80 && lanes[0].staggerMeters == 12.5f);
+  CHECK(segmentMeters[0] == 5.123f && segmentMeters[1] == 4.9f && segmentMeters[2] == 5.0f);
+  CHECK(worstError < 2000);
+  CHECK(clockSteps == 0);
+  CHECK(headSteps == 0);
+  return testResult("test_sync_follower");
+}
+
+#endif
@@ -0,0 +1,314 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Streaming JSON parser
+// A SAX-style tokenizer for request bodies that arrive in chunks: feed it
+// bytes as they are received and it calls a handler for each key, value and
+// container boundary. Memory is fixed (one token buffer and a nesting stack,
+// see JSON_MAX_TOKEN and JSON_MAX_DEPTH), so a document of any length is
+// parsed without being held in RAM. Strings longer than the token buffer,
+// deeper nesting and any syntax error stop the parse with an error message.
+//
+// Handlers see depth as the number of open containers: for a key or scalar
+// value it is the depth of the container holding it, for a start or end
+// event the depth of the container itself.
+
+enum JsonEvent {
+  JSON_OBJECT_START,
+  JSON_OBJECT_END,
+  JSON_ARRAY_START,
+  JSON_ARRAY_END,
+  JSON_KEY,
+  JSON_STRING,
+  JSON_NUMBER,
+  JSON_TRUE,
+  JSON_FALSE,
+  JSON_NULL
+};
+
+struct JsonStream;
+typedef void (*JsonHandler)(JsonStream &json, JsonEvent event, const char *text);
+
+// Parser states
+#define JSON_VALUE 0          // Expecting a value
+#define JSON_FIRST_VALUE 1    // After '[': a value or ']'
+#define JSON_FIRST_KEY 2      // After '{': a key or '}'
+#define JSON_KEY_NEXT 3       // After ',' in an object: a key
+#define JSON_COLON 4
+#define JSON_AFTER_VALUE 5    // ',' or the end of the container
+#define JSON_IN_STRING 6
+#define JSON_IN_NUMBER 7
+#define JSON_IN_LITERAL 8
+#define JSON_DONE 9
+
+struct JsonStream {
+  JsonHandler handler;
+  void *context;
+
+  uint8_t state;
+  uint8_t depth;
+  char stack[JSON_MAX_DEPTH];    // '{' or '[' for each open container
+  bool stringIsKey;
+  uint8_t escape;                // 0, 1 after '\', 2-5 in a \u escape
+  uint16_t unicode;
+
+  char token[JSON_MAX_TOKEN];
+  uint8_t tokenLength;
+
+  const char *error;             // NULL while the document is valid
+  size_t position;               // Bytes consumed
+};
+
+void jsonBegin(JsonStream &json, JsonHandler handler, void *context) {
+  json.handler = handler;
+  json.context = context;
+  json.state = JSON_VALUE;
+  json.depth = 0;
+  json.stringIsKey = false;
+  json.escape = 0;
+  json.tokenLength = 0;
+  json.error = NULL;
+  json.position = 0;
+}
+
+// Stop the parse; handlers call this to reject a valid-JSON document
+void jsonFail(JsonStream &json, const char *error) {
+  if (!json.error) json.error = error;
+}
+
+bool jsonTokenAppend(JsonStream &json, char c) {
+  if (json.tokenLength >= JSON_MAX_TOKEN - 1) {
+    jsonFail(json, "Value too long");
+    return false;
+  }
+  json.token[json.tokenLength++] = c;
+  return true;
+}
+
+void jsonEmit(JsonStream &json, JsonEvent event) {
+  json.token[json.tokenLength] = '\0';
+  json.handler(json, event, json.token);
+  json.tokenLength = 0;
+}
+
+// A value has just been completed
+void jsonValueDone(JsonStream &json) {
+  json.state = json.depth == 0 ? JSON_DONE : JSON_AFTER_VALUE;
+}
+
+void jsonOpen(JsonStream &json, char bracket) {
+  if (json.depth >= JSON_MAX_DEPTH) {
+    jsonFail(json, "Nested too deeply");
+    return;
+  }
+  json.stack[json.depth++] = bracket;
+  json.state = bracket == '{' ? JSON_FIRST_KEY : JSON_FIRST_VALUE;
+  jsonEmit(json, bracket == '{' ? JSON_OBJECT_START : JSON_ARRAY_START);
+}
+
+void jsonClose(JsonStream &json, char bracket) {
+  if (json.depth == 0 || json.stack[json.depth - 1] != (bracket == '}' ? '{' : '[')) {
+    jsonFail(json, "Mismatched bracket");
+    return;
+  }
+  jsonEmit(json, bracket == '}' ? JSON_OBJECT_END : JSON_ARRAY_END);
+  json.depth--;
+  jsonValueDone(json);
+}
+
+// Append a \u escape to the token as UTF-8
+void jsonAppendUnicode(JsonStream &json, uint16_t c) {
+  if (c < 0x80) {
+    jsonTokenAppend(json, c);
+  } else if (c < 0x800) {
+    jsonTokenAppend(json, 0xC0 | (c >> 6));
+    jsonTokenAppend(json, 0x80 | (c & 0x3F));
+  } else {
+    jsonTokenAppend(json, 0xE0 | (c >> 12));
+    jsonTokenAppend(json, 0x80 | ((c >> 6) & 0x3F));
+    jsonTokenAppend(json, 0x80 | (c & 0x3F));
+  }
+}
+
+void jsonStringChar(JsonStream &json, char c) {
+  if (json.escape == 1) {
+    json.escape = 0;
+    switch (c) {
+      case '"': case '\\': case '/': jsonTokenAppend(json, c); break;
+      case 'b': jsonTokenAppend(json, '\b'); break;
+      case 'f': jsonTokenAppend(json, '\f'); break;
+      case 'n': jsonTokenAppend(json, '\n'); break;
+      case 'r': jsonTokenAppend(json, '\r'); break;
+      case 't': jsonTokenAppend(json, '\t'); break;
+      case 'u': json.escape = 2; json.unicode = 0; break;
+      default: jsonFail(json, "Bad escape"); break;
+    }
+  } else if (json.escape >= 2) {
+    int digit = isdigit(c) ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+    if (digit < 0) {
+      jsonFail(json, "Bad escape");
+      return;
+    }
+    json.unicode = (json.unicode << 4) | digit;
+    if (++json.escape == 6) {
+      json.escape = 0;
+      jsonAppendUnicode(json, json.unicode);
+    }
+  } else if (c == '\\') {
+    json.escape = 1;
+  } else if (c == '"') {
+    if (json.stringIsKey) {
+      jsonEmit(json, JSON_KEY);
+      json.state = JSON_COLON;
+    } else {
+      jsonEmit(json, JSON_STRING);
+      jsonValueDone(json);
+    }
+  } else if ((uint8_t)c < 0x20) {
+    jsonFail(json, "Control character in string");
+  } else {
+    jsonTokenAppend(json, c);
+  }
+}
+
+// Start of a value at c; false if c cannot start one
+bool jsonStartValue(JsonStream &json, char c) {
+  if (c == '{' || c == '[') {
+    jsonOpen(json, c);
+  } else if (c == '"') {
+    json.stringIsKey = false;
+    json.state = JSON_IN_STRING;
+  } else if (c == '-' || isdigit(c)) {
+    json.state = JSON_IN_NUMBER;
+    jsonTokenAppend(json, c);
+  } else if (c >= 'a' && c <= 'z') {
+    json.state = JSON_IN_LITERAL;
+    jsonTokenAppend(json, c);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// A number or literal ended just before the current character
+void jsonEndBareValue(JsonStream &json) {
+  json.token[json.tokenLength] = '\0';
+
+  if (json.state == JSON_IN_NUMBER) {
+    char *end;
+    strtod(json.token, &end);
+    if (*end != '\0') {
+      jsonFail(json, "Bad number");
+      return;
+    }
+    jsonEmit(json, JSON_NUMBER);
+  } else if (strcmp(json.token, "true") == 0) {
+    jsonEmit(json, JSON_TRUE);
+  } else if (strcmp(json.token, "false") == 0) {
+    jsonEmit(json, JSON_FALSE);
+  } else if (strcmp(json.token, "null") == 0) {
+    jsonEmit(json, JSON_NULL);
+  } else {
+    jsonFail(json, "Bad literal");
+    return;
+  }
+  jsonValueDone(json);
+}
+
+void jsonChar(JsonStream &json, char c) {
+  bool space = c == ' ' || c == '\t' || c == '\n' || c == '\r';
+
+  switch (json.state) {
+    case JSON_IN_STRING:
+      jsonStringChar(json, c);
+      return;
+
+    case JSON_IN_NUMBER:
+      if (isdigit(c) || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+        jsonTokenAppend(json, c);
+        return;
+      }
+      jsonEndBareValue(json);
+      break;  // c still needs handling in the new state
+
+    case JSON_IN_LITERAL:
+      if (c >= 'a' && c <= 'z') {
+        jsonTokenAppend(json, c);
+        return;
+      }
+      jsonEndBareValue(json);
+      break;
+  }
+  if (json.error || space) return;
+
+  switch (json.state) {
+    case JSON_VALUE:
+      if (!jsonStartValue(json, c)) jsonFail(json, "Expected a value");
+      break;
+
+    case JSON_FIRST_VALUE:
+      if (c == ']') {
+        jsonClose(json, c);
+      } else if (!jsonStartValue(json, c)) {
+        jsonFail(json, "Expected a value");
+      }
+      break;
+
+    case JSON_FIRST_KEY:
+    case JSON_KEY_NEXT:
+      if (c == '"') {
+        json.stringIsKey = true;
+        json.state = JSON_IN_STRING;
+      } else if (c == '}' && json.state == JSON_FIRST_KEY) {
+        jsonClose(json, c);
+      } else {
+        jsonFail(json, "Expected a key");
+      }
+      break;
+
+    case JSON_COLON:
+      if (c == ':') {
+        json.state = JSON_VALUE;
+      } else {
+        jsonFail(json, "Expected ':'");
+      }
+      break;
+
+    case JSON_AFTER_VALUE:
+      if (c == ',') {
+        json.state = json.stack[json.depth - 1] == '{' ? JSON_KEY_NEXT : JSON_VALUE;
+      } else if (c == '}' || c == ']') {
+        jsonClose(json, c);
+      } else {
+        jsonFail(json, "Expected ',' or the end of a container");
+      }
+      break;
+
+    case JSON_DONE:
+      jsonFail(json, "Data after the document");
+      break;
+  }
+}
+
+// Parse the next chunk of the document; false once it is known to be bad
+bool jsonFeed(JsonStream &json, const char *data, size_t length) {
+  for (size_t i = 0; i < length && !json.error; i++) {
+    jsonChar(json, data[i]);
+    json.position++;
+  }
+  return !json.error;
+}
+
+// End of input; false unless exactly one complete document was parsed
+bool jsonFinish(JsonStream &json) {
+  if (!json.error && (json.state == JSON_IN_NUMBER || json.state == JSON_IN_LITERAL)) {
+    jsonEndBareValue(json);
+  }
+  if (!json.error && json.state != JSON_DONE) jsonFail(json, "Unexpected end of document");
+  return !json.error;
+}
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef LANES_H
+#define LANES_H
+
+#include <FastLED.h>
+#include <Preferences.h>
+#include "config.h"
+
+// Lanes
+// Each lane has its own strip on its own data pin and its own buffers in
+// leds[lane] (drawn) and ledOut[lane] (sent, see led_output.h). All lane strips share the segment layout of lane 1 (segment
+// k covers the same stretch of the oval in every lane), so a lap phase maps
+// to the same unit index in every lane. Lanes differ in how long a lap is
+// and where their start line is staggered to.
+struct Lane {
+  float extraMeters;    // Lap length beyond lane 1 (about 7.67m per lane on a 400m oval)
+  float staggerMeters;  // Start line stagger, measured forward along the lane
+};
+
+extern Preferences preferences;
+extern Lane lanes[NUM_LANES];
+extern CRGB ledOut[NUM_LANES][MAX_LOGICAL_LEDS];
+
+// Register one FastLED output per lane; pins must be compile-time constants
+void addLaneOutputs() {
+  FastLED.addLeds<WS2811, LED_PIN, RBG>(ledOut[0], MAX_LOGICAL_LEDS);
+#if NUM_LANES > 1
+  FastLED.addLeds<WS2811, LANE2_PIN, RBG>(ledOut[1], MAX_LOGICAL_LEDS);
+#endif
+#if NUM_LANES > 2
+  FastLED.addLeds<WS2811, LANE3_PIN, RBG>(ledOut[2], MAX_LOGICAL_LEDS);
+#endif
+#if NUM_LANES > 3
+  FastLED.addLeds<WS2811, LANE4_PIN, RBG>(ledOut[3], MAX_LOGICAL_LEDS);
+#endif
+#if NUM_LANES > 4
+  FastLED.addLeds<WS2811, LANE5_PIN, RBG>(ledOut[4], MAX_LOGICAL_LEDS);
+#endif
+#if NUM_LANES > 5
+  FastLED.addLeds<WS2811, LANE6_PIN, RBG>(ledOut[5], MAX_LOGICAL_LEDS);
+#endif
+#if NUM_LANES > 6
+  FastLED.addLeds<WS2811, LANE7_PIN, RBG>(ledOut[6], MAX_LOGICAL_LEDS);
+#endif
+#if NUM_LANES > 7
+  FastLED.addLeds<WS2811, LANE8_PIN, RBG>(ledOut[7], MAX_LOGICAL_LEDS);
+#endif
+}
+
+// Load lane geometry (no extra length or stagger where none was stored)
+void loadLanes() {
+  for (int l = 0; l < NUM_LANES; l++) {
+    lanes[l].extraMeters = 0;
+    lanes[l].staggerMeters = 0;
+  }
+  preferences.getBytes("lanes", lanes, sizeof(lanes));
+}
+
+void saveLanes() {
+  preferences.putBytes("lanes", lanes, sizeof(lanes));
+}
+
+#endif
@@ -4,26 +4,227 @@
 #include <FastLED.h>
 #include "config.h"
 #include "pacer.h"
+#include "clock.h"
+#include "led_output.h"
 
-// Render LEDs based on current pacer positions
-void renderLEDs() {
-  FastLED.clear();
+extern bool systemRunning;
+extern clock_us_t sessionStartTime;
+
+// Frames are drawn incrementally: rather than clearing every lane and
+// redrawing it, each frame fades or erases only what the pacers drew in the
+// previous frame, so the cost scales with the number of lit pixels. Pacers
+// are drawn over a cached background layer of track markings. A pacer
+// with a trail leaves a comet tail that decays exponentially behind it.
+//
+// Every change to the pixel buffers bumps frameGeneration. showFrame() only
+// pushes the buffers to the strip when the generation has moved on since the
+// last push (or the keep-alive is due), since a show ties up the data line
+// for ~15 ms at 500 LEDs and slow paces often don't move a whole unit. A
+// changed frame that arrives while the previous one is still being sent
+// stays pending and goes out on a later pass.
+
+uint32_t frameGeneration = 0;
+uint32_t shownGeneration = 0;
+clock_us_t lastShowTime = 0;
+uint32_t framesShown = 0;
+uint32_t framesSkipped = 0;
 
-  for (int i = 0; i < MAX_PACERS; i++) {
-    if (!pacers[i].enabled) continue;
+// Call op(from, n) for each contiguous run of this controller's pixels
+// covering count global track units from unit, as an index into a lane's
+// buffer and a length. The span is split at most once, where it wraps past
+// the finish line, and each piece is clipped to the units wired to this
+// controller (see NODE_FIRST_SEGMENT), so callers work on whole runs with
+// no per-pixel modulo.
+template<typename Op>
+void forUnitRuns(int unit, int count, Op op) {
+  const int firstUnit = NODE_FIRST_SEGMENT * LOGICAL_UNITS_PER_SEGMENT;
 
-    int startUnit = (int)pacers[i].currentPosition;
+  if (count <= 0) return;
+  if (count > current_NUM_LEDS) count = current_NUM_LEDS;
+  unit %= current_NUM_LEDS;
+  if (unit < 0) unit += current_NUM_LEDS;
+
+  int pieces[2][2] = {{unit, min(unit + count, current_NUM_LEDS)}, {0, unit + count - current_NUM_LEDS}};
+  for (int p = 0; p < 2; p++) {
+    int from = max(pieces[p][0] - firstUnit, 0);
+    int to = min(pieces[p][1] - firstUnit, MAX_LOGICAL_LEDS);
+    if (from < to) op(from, to - from);
+  }
+}
 
-    for (int j = 0; j < LEDS_PER_SEGMENT; j++) {
-      int unitIndex = (startUnit + j) % current_NUM_LEDS;
+// Call op(pixels, n) for each run of a lane's pixels; see forUnitRuns
+template<typename Op>
+void forUnitSpan(int lane, int unit, int count, Op op) {
+  forUnitRuns(unit, count, [lane, &op](int from, int n) {
+    op(&leds[lane][from], n);
+  });
+}
+
+// Background layer
+// Track markings (start and finish lines, distance markers, relay exchange
+// zones) are painted dimly into background[] once whenever the track
+// geometry changes. A frame starts as a copy of it, and pacers are drawn on
+// top; pixels a pacer leaves behind are restored or faded back towards the
+// background rather than to black, so the markings never need redrawing.
+// The markings only show during a session; between sessions the strip is
+// dark (see power.h).
+CRGB background[NUM_LANES][MAX_LOGICAL_LEDS];
+
+void paintBackground(int lane, int unit, int count, CRGB color) {
+  forUnitRuns(unit, count, [lane, color](int from, int n) {
+    fill_solid(&background[lane][from], n, color);
+  });
+}
+
+// Unit under a point meters along a lap of lapMeters
+int metersToUnit(float meters, float lapMeters) {
+  return phaseToUnits16(metersToPhase(meters, lapMeters)) >> 4;
+}
 
-      leds[unitIndex] = pacers[i].color;
+// Blank every lane back to the background (to black outside a session) and
+// forget what was drawn; the next frame starts fresh. Callers that start or
+// stop a session set systemRunning first.
+void resetFrame() {
+  if (systemRunning) {
+    memcpy(leds, background, sizeof(leds));
+  } else {
+    memset(leds, 0, sizeof(leds));
+  }
+  frameGeneration++;
+  for (int s = 0; s < MAX_PACERS; s++) {
+    pacerHot.lastDrawn[s] = -1;
+  }
+}
+
+// Repaint the background for the current segments, calibration and lanes,
+// and restart the frame on it
+void buildBackground() {
+  memset(background, 0, sizeof(background));
+
+#if TRACK_MARKINGS
+  for (int l = 0; l < NUM_LANES; l++) {
+    // Markers and zones are radial lines, at the same lap phase in every lane
+    for (float m = MARKER_SPACING_M; m < trackMeters - MARKER_SPACING_M / 2; m += MARKER_SPACING_M) {
+      int from = metersToUnit(m - EXCHANGE_ZONE_BEFORE_M, trackMeters);
+      int to = metersToUnit(m + EXCHANGE_ZONE_AFTER_M, trackMeters);
+      if (to < from) to += current_NUM_LEDS;
+      paintBackground(l, from, to - from, EXCHANGE_ZONE_COLOR);
+      paintBackground(l, metersToUnit(m, trackMeters), MARKER_UNITS, MARKER_COLOR);
     }
 
-    for (int k = current_NUM_LEDS; k < MAX_LOGICAL_LEDS; k++) {
-        leds[k] = CRGB::Black;
+    // The finish line is common; start lines are staggered per lane
+    paintBackground(l, 0, MARKER_UNITS, START_LINE_COLOR);
+    if (lanes[l].staggerMeters != 0) {
+      paintBackground(l, metersToUnit(lanes[l].staggerMeters, trackMeters + lanes[l].extraMeters), MARKER_UNITS, START_LINE_COLOR);
     }
   }
+#endif
+
+  resetFrame();
+}
+
+// Fade or erase what the pacer in slot s drew last frame, ahead of drawing
+// it at its new head
+void retirePacerFrame(int s) {
+  int lane = pacerHot.lane[s];
+  int head = pacerHot.head[s];
+  int last = pacerHot.lastDrawn[s];
+  int trail = pacerHot.trail[s];
+  int footprint = trail + pacerHot.body[s];
+  int moved = head - last;
+  if (moved < 0) moved += current_NUM_LEDS;
+
+  // Moved further than its own footprint: erase the old footprint outright
+  if (moved >= footprint) {
+    moved = footprint;
+  }
+
+  // Pixels that fell off the back of the tail go back to the background
+  forUnitRuns(last - trail, moved, [lane](int from, int n) {
+    memcpy(&leds[lane][from], &background[lane][from], n * sizeof(CRGB));
+  });
+
+  if (trail == 0) return;
+
+  // The rest of the old footprint fades towards the background in
+  // proportion to the distance moved, reaching about 1/256 of the way back
+  // after the pacer has moved a full trail length
+  uint8_t scale = (uint8_t)(255 * expf(-5.5f * moved / trail));
+  forUnitRuns(last - trail + moved, footprint - moved, [lane, scale](int from, int n) {
+    blend(&background[lane][from], &leds[lane][from], &leds[lane][from], n, scale);
+  });
+}
+
+// Draw the active pacers; see updateKernel for the COUNT specializations
+template<int COUNT>
+void renderKernel() {
+  const int count = COUNT ? COUNT : pacerHot.count;
+
+  // Retire every pacer's previous frame before drawing any, so a pacer's
+  // body is never erased by another pacer's tail
+  for (int s = 0; s < count; s++) {
+    if (pacerHot.lastDrawn[s] >= 0) retirePacerFrame(s);
+  }
+
+  for (int s = 0; s < count; s++) {
+    int startUnit = pacerHot.head[s];
+    CRGB color = pacerHot.color[s];
+
+    forUnitSpan(pacerHot.lane[s], startUnit, pacerHot.body[s], [color](CRGB *pixels, int n) {
+      fill_solid(pixels, n, color);
+    });
+
+    pacerHot.lastDrawn[s] = startUnit;
+  }
+}
+
+// Render LEDs based on current pacer positions
+// Positions are on the global track; this controller draws only the units
+// wired to it, starting at NODE_FIRST_SEGMENT. Every lane's buffer is drawn
+// in this one pass and pushed by a single showFrame().
+void renderLEDs() {
+  // Countdown: pacers wait at their start positions, blinking once a second
+  clock_us_t now = trackMicros();
+  if (now < sessionStartTime && (sessionStartTime - now) % CLOCK_US_PER_SEC < CLOCK_US_PER_SEC / 2) {
+    if (pacerHot.count > 0 && pacerHot.lastDrawn[0] >= 0) resetFrame();
+    return;
+  }
+
+  // Redraw everything if any pacer moved, since one pacer's retired tail
+  // may have overlapped another's body; otherwise the frame is unchanged
+  bool moved = false;
+  for (int s = 0; s < pacerHot.count; s++) {
+    if (pacerHot.head[s] != pacerHot.lastDrawn[s]) moved = true;
+  }
+  if (!moved) return;
+  frameGeneration++;
+
+  switch (pacerHot.count) {
+    case 0: break;
+    case 1: renderKernel<1>(); break;
+    case 2: renderKernel<2>(); break;
+    case 3: renderKernel<3>(); break;
+#if MAX_PACERS > 3
+    default: renderKernel<0>(); break;
+#endif
+  }
+}
+
+// Push the frame to the strip if it changed since the last push; true if
+// it was pushed
+bool showFrame() {
+  clock_us_t now = clockMicros();
+
+  if (frameGeneration == shownGeneration && now - lastShowTime < SHOW_KEEPALIVE_MS * CLOCK_US_PER_MS) {
+    framesSkipped++;
+    return false;
+  }
+
+  if (!submitFrame()) return false;
+  shownGeneration = frameGeneration;
+  lastShowTime = now;
+  framesShown++;
+  return true;
 }
 
 #endif
@@ -0,0 +1,73 @@
+#ifndef LED_OUTPUT_H
+#define LED_OUTPUT_H
+
+#include <FastLED.h>
+#include "config.h"
+#include "clock.h"
+
+// Non-blocking LED output
+// Frames are drawn into leds[] and written to the strips by an output task,
+// from ledOut[], the buffers registered with FastLED. submitFrame() copies a
+// finished frame into ledOut[], wakes the task and returns at once, so the
+// loop keeps serving clients and drawing the next frame into leds[] while
+// the current one shifts out.
+//
+// ledOut[] belongs to the output task from submitFrame() until the task
+// gives outputFree back at the end of the transfer; nothing else may touch
+// it in that window. The hand-off is a task notification one way and a
+// binary semaphore the other, not a shared flag: both order the copy into
+// ledOut[] against the transfer across the two cores.
+//
+// The task is pinned to core 1 with the loop. FastLED's RMT driver refills
+// its buffers from an interrupt on the core that called show(), and on core
+// 0 the WiFi stack's interrupts delay those refills enough to glitch the
+// strip timing. The task blocks for the rest of the transfer, so the loop
+// keeps the core.
+
+extern CRGB leds[NUM_LANES][MAX_LOGICAL_LEDS];
+extern CRGB ledOut[NUM_LANES][MAX_LOGICAL_LEDS];
+
+TaskHandle_t outputTask = NULL;
+SemaphoreHandle_t outputFree = NULL;  // Taken by submitFrame(), given back when sent
+volatile uint32_t outputMicros = 0;  // Duration of the last transfer
+
+void outputTaskLoop(void *param) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    clock_us_t start = clockMicros();
+    FastLED.show();
+    outputMicros = clockMicros() - start;
+
+    xSemaphoreGive(outputFree);
+  }
+}
+
+void beginOutput() {
+  outputFree = xSemaphoreCreateBinary();
+  xSemaphoreGive(outputFree);
+  xTaskCreatePinnedToCore(outputTaskLoop, "output", 4096, NULL, 2, &outputTask, 1);
+}
+
+// Whether a frame is still being sent
+bool outputBusy() {
+  return uxSemaphoreGetCount(outputFree) == 0;
+}
+
+// Hand the frame in leds[] to the output task; false if the previous frame
+// is still being sent
+bool submitFrame() {
+  if (xSemaphoreTake(outputFree, 0) != pdTRUE) return false;
+
+  memcpy(ledOut, leds, sizeof(ledOut));
+  xTaskNotifyGive(outputTask);
+  return true;
+}
+
+// Block until the last submitted frame is on the strip
+void waitFrameShown() {
+  xSemaphoreTake(outputFree, portMAX_DELAY);
+  xSemaphoreGive(outputFree);
+}
+
+#endif
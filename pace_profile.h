@@ -0,0 +1,142 @@
+#ifndef PACE_PROFILE_H
+#define PACE_PROFILE_H
+
+#include <math.h>
+#include "config.h"
+#include "clock.h"
+#include "arena.h"
+
+// Pace profiles
+// A profile is a list of steps, each lasting a number of seconds, over which
+// the pace changes linearly from one lap time to another: a negative split,
+// a progression run, or a fast start settling into race pace. After the last
+// step the pacer holds the final pace.
+//
+// Speeds are in Q16 laps (65536 per lane-1 lap) per second. Velocity is
+// linear within each step, so distance covered is a closed-form quadratic
+// from the step's start. Each step's starting distance is precomputed, so a
+// position lookup is O(1) and exact at any frame rate, with no stepping and
+// no accumulated error.
+
+struct ProfileStep {
+  float seconds;       // Duration of the step
+  float fromLapTime;   // Lap time at the start of the step
+  float toLapTime;     // Lap time at the end of the step
+};
+
+// Profile flags
+#define PROFILE_STOP_AT_END 0x01  // Stop after the last step instead of holding its pace
+#define PROFILE_FIXED_TRACK 0x02  // Lap times hold only for the track length it was built for (a ghost)
+
+// The profile as configured; this is what is stored and synced
+struct ProfileSpec {
+  uint8_t count;
+  uint8_t flags;
+  ProfileStep steps[MAX_PROFILE_STEPS];
+};
+
+// One step compiled for evaluation
+struct ProfileSegment {
+  clock_us_t start;     // Offset from the pacer's start
+  float speed;          // Q16 laps per second at the start of the segment
+  float accel;          // Q16 laps per second squared
+  uint64_t travelled;   // Q16 laps covered before the segment
+};
+
+struct PaceProfile {
+  ProfileSpec spec;
+  ProfileSegment segments[MAX_PROFILE_STEPS + 1];  // Last one holds the final pace (or stops)
+  uint8_t cursor;       // Segment of the most recent lookup
+};
+
+// Precompute each segment's start time and starting distance
+void compileProfile(PaceProfile &profile) {
+  clock_us_t start = 0;
+  double travelled = 0;
+  uint8_t count = profile.spec.count;
+
+  for (int j = 0; j < count; j++) {
+    const ProfileStep &step = profile.spec.steps[j];
+    double fromSpeed = 65536.0 / step.fromLapTime;
+    double toSpeed = 65536.0 / step.toLapTime;
+    double accel = (toSpeed - fromSpeed) / step.seconds;
+
+    profile.segments[j].start = start;
+    profile.segments[j].speed = fromSpeed;
+    profile.segments[j].accel = accel;
+    profile.segments[j].travelled = (uint64_t)(travelled + 0.5);
+
+    travelled += fromSpeed * step.seconds + 0.5 * accel * step.seconds * step.seconds;
+    start += (clock_us_t)(step.seconds * CLOCK_US_PER_SEC);
+  }
+
+  profile.segments[count].start = start;
+  profile.segments[count].speed = (profile.spec.flags & PROFILE_STOP_AT_END) ? 0 : 65536.0 / profile.spec.steps[count - 1].toLapTime;
+  profile.segments[count].accel = 0;
+  profile.segments[count].travelled = (uint64_t)(travelled + 0.5);
+  profile.cursor = 0;
+}
+
+// Q16 laps covered elapsed microseconds after the start
+// Time only moves forward between frames, so the cursor only ever moves
+// forward and usually not at all.
+uint64_t profileTravelled(PaceProfile &profile, clock_us_t elapsed) {
+  uint8_t count = profile.spec.count;
+
+  if (elapsed < profile.segments[profile.cursor].start) profile.cursor = 0;
+  while (profile.cursor < count && elapsed >= profile.segments[profile.cursor + 1].start) {
+    profile.cursor++;
+  }
+
+  const ProfileSegment &seg = profile.segments[profile.cursor];
+  float dt = (elapsed - seg.start) * 1e-6f;
+  return seg.travelled + (uint64_t)(seg.speed * dt + 0.5f * seg.accel * dt * dt);
+}
+
+// Offset from the start at which the pacer has covered target Q16 laps.
+// Used for exact lap crossing times, so a linear scan is fine.
+clock_us_t profileTimeAt(const PaceProfile &profile, uint64_t target) {
+  int j = profile.spec.count;
+  while (j > 0 && profile.segments[j].travelled > target) j--;
+
+  const ProfileSegment &seg = profile.segments[j];
+  double d = (double)(target - seg.travelled);
+  double v = seg.speed;
+  if (v <= 0 && seg.accel <= 0) return seg.start;  // Stopped; never reaches target
+
+  // Root of 0.5*a*t^2 + v*t - d = 0, in the form that stays accurate as a -> 0
+  double t = 2 * d / (v + sqrt(v * v + 2 * seg.accel * d));
+  return seg.start + (clock_us_t)(t * CLOCK_US_PER_SEC + 0.5);
+}
+
+// Parse <seconds>:<from lap time>:<to lap time>[;...] into spec
+bool parseProfile(StrView text, ProfileSpec &spec) {
+  spec.count = 0;
+  spec.flags = 0;
+  int lastPos = 0;
+
+  while (lastPos < text.len) {
+    if (spec.count >= MAX_PROFILE_STEPS) return false;
+
+    int end = text.indexOf(';', lastPos);
+    if (end == -1) end = text.len;
+    StrView stepData = text.sub(lastPos, end);
+
+    int colon1 = stepData.indexOf(':');
+    int colon2 = stepData.indexOf(':', colon1 + 1);
+    if (colon1 == -1 || colon2 == -1) return false;
+
+    ProfileStep &step = spec.steps[spec.count];
+    step.seconds = stepData.sub(0, colon1).toFloat();
+    step.fromLapTime = stepData.sub(colon1 + 1, colon2).toFloat();
+    step.toLapTime = stepData.sub(colon2 + 1).toFloat();
+    if (step.seconds <= 0 || step.fromLapTime <= 0 || step.toLapTime <= 0) return false;
+
+    spec.count++;
+    lastPos = end + 1;
+  }
+
+  return spec.count > 0;
+}
+
+#endif
@@ -3,30 +3,72 @@
 
 #include <FastLED.h>
 #include "config.h"
+#include "clock.h"
+#include "events.h"
+#include "calibration.h"
+#include "lanes.h"
+#include "pace_profile.h"
+#include "ghost.h"
 
 // Pacer Structure
+// The configuration of a pacer, as set by START. Per-frame state lives in
+// PacerHot below.
 struct Pacer {
   bool enabled;
   float timePerLap;      // seconds to complete 5m lap
+  PaceProfile profile;   // Variable pace; used instead of timePerLap when it has steps
   int startPosition;     // meters (0m to 4m)
   CRGB color;
-  float currentPosition; // Position in logical units (0 to current_NUM_LEDS - 1)
-  unsigned long lastUpdate;
+  uint8_t lane;          // Lane strip this pacer runs on
+  uint16_t trailUnits;   // Comet trail length behind the pacer (0 = none)
+  uint16_t bodyUnits;    // Length of the pacer itself
+  clock_us_t startTime;  // Clock time at which the pacer was at startPosition
+};
+
+// Hot pacer state
+// Everything updatePacers() and renderLEDs() touch every frame, as a
+// structure of arrays over the active pacers only. Slot s holds pacer
+// pacer[s]; slots are dense, so the frame loops have no enabled checks, and
+// all per-pacer constants (lap time in the lane, start phase) are worked out
+// once by activatePacers() rather than every frame.
+struct PacerHot {
+  uint8_t count;                      // Active pacers (slots in use)
+  uint8_t pacer[MAX_PACERS];          // Pacer index of each slot
+  int8_t slotOf[MAX_PACERS];          // Slot of each pacer (-1 = inactive)
+
+  clock_us_t startTime[MAX_PACERS];
+  clock_us_t lapMicros[MAX_PACERS];   // Lap time in the pacer's lane (0 = profiled)
+  float laneScale[MAX_PACERS];        // Lane lap length over lane-1 lap length
+  uint64_t startPhase[MAX_PACERS];    // Q16 laps from the finish line at startTime (start position plus stagger)
+  uint32_t lapCount[MAX_PACERS];      // Finish-line crossings since start
+  clock_us_t lastLapTime[MAX_PACERS];
+
+  uint32_t phase[MAX_PACERS];         // Fraction of the physical lap covered, Q16
+  uint16_t head[MAX_PACERS];          // First unit of the pacer's body
+  int16_t lastDrawn[MAX_PACERS];      // Head drawn last frame (-1 = nothing drawn)
+  uint8_t lane[MAX_PACERS];
+  uint16_t trail[MAX_PACERS];
+  uint16_t body[MAX_PACERS];
+  CRGB color[MAX_PACERS];
 };
 
 // Global Variables (extern means defined elsewhere, in main .ino)
 extern Pacer pacers[MAX_PACERS];
-extern CRGB leds[MAX_LOGICAL_LEDS];
+extern PacerHot pacerHot;
 extern int current_NUM_LEDS;
 extern int TOTAL_SEGMENTS;
+extern clock_us_t sessionStartTime;
+extern bool systemRunning;
 
 // Function to convert hex string to CRGB color
-CRGB hexToColor(String hex) {
+CRGB hexToColor(StrView hex) {
   if (hex.startsWith("#")) {
-    hex = hex.substring(1);
+    hex = hex.sub(1);
   }
 
-  long number = strtol(hex.c_str(), NULL, 16);
+  char digits[8];
+  hex.copyTo(digits, sizeof(digits));
+  long number = strtol(digits, NULL, 16);
   int r = (number >> 16) & 0xFF;
   int g = (number >> 8) & 0xFF;
   int b = number & 0xFF;
@@ -34,10 +76,172 @@ CRGB hexToColor(String hex) {
   return CRGB(r, g, b);
 }
 
-// Parse START command and configure pacers
-void parseStartCommand(String cmd) {
-  cmd = cmd.substring(6);
+// Length of one lap in the pacer's lane
+float pacerLapMeters(const Pacer &pacer) {
+  return trackMeters + lanes[pacer.lane].extraMeters;
+}
+
+// Phase the pacer starts at: its start position plus its lane's stagger
+uint32_t pacerStartPhase(const Pacer &pacer) {
+  return metersToPhase(pacer.startPosition + lanes[pacer.lane].staggerMeters, pacerLapMeters(pacer));
+}
+
+// Install a stored or received profile spec (count 0 = constant pace)
+void setPacerProfile(Pacer &pacer, const ProfileSpec &spec) {
+  pacer.profile.spec = spec;
+  if (spec.count > MAX_PROFILE_STEPS) pacer.profile.spec.count = 0;
+  if (pacer.profile.spec.count > 0) compileProfile(pacer.profile);
+}
+
+// A pacer's configuration as broadcast to sync followers and snapshotted
+// for session restore. Packed, so the datagram and the stored bytes have
+// one layout.
+struct __attribute__((packed)) PacerConfig {
+  uint8_t enabled;
+  float timePerLap;
+  int16_t startPosition;
+  uint8_t lane;
+  uint8_t r, g, b;
+  uint16_t trailUnits;
+  uint16_t bodyUnits;
+  ProfileSpec profile;
+};
+
+void packPacerConfig(const Pacer &pacer, PacerConfig &config) {
+  config.enabled = pacer.enabled;
+  config.timePerLap = pacer.timePerLap;
+  config.startPosition = pacer.startPosition;
+  config.lane = pacer.lane;
+  config.r = pacer.color.r;
+  config.g = pacer.color.g;
+  config.b = pacer.color.b;
+  config.trailUnits = pacer.trailUnits;
+  config.bodyUnits = pacer.bodyUnits;
+  config.profile = pacer.profile.spec;
+}
+
+// Load a packed configuration, clamping what could be out of range, with
+// the pacer at its start position at startTime
+void unpackPacerConfig(const PacerConfig &config, Pacer &pacer, clock_us_t startTime) {
+  pacer.enabled = config.enabled;
+  pacer.timePerLap = config.timePerLap;
+  pacer.startPosition = config.startPosition;
+  pacer.lane = config.lane < NUM_LANES ? config.lane : 0;
+  setPacerProfile(pacer, config.profile);
+  pacer.color = CRGB(config.r, config.g, config.b);
+  pacer.trailUnits = config.trailUnits;
+  pacer.bodyUnits = constrain(config.bodyUnits, 1, MAX_BODY_UNITS);
+  pacer.startTime = startTime;
+}
+
+// Q16 laps of its lane the pacer in slot s of hot has covered since its
+// startTime, not counting its start phase
+inline uint64_t pacerTravelled(const PacerHot &hot, int s, clock_us_t now) {
+  clock_us_t elapsed = now > hot.startTime[s] ? now - hot.startTime[s] : 0;
+
+  if (hot.lapMicros[s]) {
+    return (elapsed << 16) / hot.lapMicros[s];
+  }
+  return profileTravelled(pacers[hot.pacer[s]].profile, elapsed) / hot.laneScale[s];
+}
+
+// Rebuild the hot state from the pacer configuration. Call after anything
+// that changes pacers, lanes or track length. With restart, lap counts and
+// drawing start over; otherwise pacers that stay active keep them, and a
+// pacer already under way keeps its lap count and lap phase, so changing
+// the track length, calibration or lanes mid-session moves it to the same
+// fraction of the new lap and it carries on from there.
+void activatePacers(bool restart) {
+  PacerHot old = pacerHot;
+  pacerHot.count = 0;
+  clock_us_t now = trackMicros();
+
+  for (int i = 0; i < MAX_PACERS; i++) {
+    pacerHot.slotOf[i] = -1;
+    if (!pacers[i].enabled) continue;
+
+    if (pacers[i].timePerLap <= 0) {
+        pacers[i].timePerLap = 1.0;
+    }
+
+    int s = pacerHot.count++;
+    float laneScale = pacerLapMeters(pacers[i]) / trackMeters;
+
+    pacerHot.pacer[s] = i;
+    pacerHot.slotOf[i] = s;
+    pacerHot.startTime[s] = pacers[i].startTime;
+    pacerHot.lapMicros[s] = pacers[i].profile.spec.count > 0 ? 0 :
+        (clock_us_t)(pacers[i].timePerLap * laneScale * CLOCK_US_PER_SEC);
+    pacerHot.laneScale[s] = laneScale;
+    pacerHot.startPhase[s] = pacerStartPhase(pacers[i]);
+    pacerHot.phase[s] = pacerHot.startPhase[s];
+    pacerHot.head[s] = phaseToUnits16(pacerHot.startPhase[s]) >> 4;
+    pacerHot.lane[s] = pacers[i].lane;
+    pacerHot.trail[s] = pacers[i].trailUnits;
+    pacerHot.body[s] = pacers[i].bodyUnits;
+    pacerHot.color[s] = pacers[i].color;
+
+    int was = old.slotOf[i];
+    bool keep = !restart && was >= 0 && was < old.count;
+    pacerHot.lapCount[s] = keep ? old.lapCount[was] : 0;
+    pacerHot.lastLapTime[s] = keep ? old.lastLapTime[was] : pacers[i].startTime;
+    pacerHot.lastDrawn[s] = keep ? old.lastDrawn[was] : -1;
+
+    // Under way: choose the start phase that puts it where it was, in
+    // modular arithmetic since the new lap may have covered more
+    if (keep && now > pacerHot.startTime[s]) {
+      uint64_t total = old.startPhase[was] + pacerTravelled(old, was, now);
+      pacerHot.startPhase[s] = total - pacerTravelled(pacerHot, s, now);
+      pacerHot.phase[s] = (uint32_t)(total & 0xFFFF);
+      pacerHot.head[s] = phaseToUnits16(pacerHot.phase[s]) >> 4;
+    }
+  }
+}
+
+// Inverse of the position computation: offset from the start at which the
+// pacer in slot s has covered travelled Q16 laps of its lane
+clock_us_t pacerTimeAt(int s, uint64_t travelled) {
+  if (pacerHot.lapMicros[s] == 0) {
+    const Pacer &pacer = pacers[pacerHot.pacer[s]];
+    return profileTimeAt(pacer.profile, (uint64_t)(travelled * pacerHot.laneScale[s]));
+  }
+
+  return (travelled * pacerHot.lapMicros[s] + 0x8000) >> 16;
+}
+
+// Publish a lap event for every finish-line crossing up to crossings.
+// Crossings are rare next to frames, so this stays out of the frame loop.
+void __attribute__((noinline)) emitLapEvents(int s, uint32_t crossings) {
+  while (pacerHot.lapCount[s] < crossings) {
+    uint32_t lap = ++pacerHot.lapCount[s];
+    uint64_t toCrossing = ((uint64_t)lap << 16) - pacerHot.startPhase[s];
+    clock_us_t lapTime = pacerHot.startTime[s] + pacerTimeAt(s, toCrossing);
+    uint8_t flags = (lap == 1 && pacerHot.startPhase[s] > 0) ? LAP_EVENT_PARTIAL : 0;
+
+    pushLapEvent(pacerHot.pacer[s], flags, lap, lapTime, (uint32_t)(lapTime - pacerHot.lastLapTime[s]));
+    pacerHot.lastLapTime[s] = lapTime;
+  }
+}
+
+// Count the laps each pacer has already run by now without publishing them,
+// for a session resumed after a reset whose laps went out before it
+void resumeLapCounts(clock_us_t now) {
+  for (int s = 0; s < pacerHot.count; s++) {
+    uint32_t crossings = (pacerTravelled(pacerHot, s, now) + pacerHot.startPhase[s]) >> 16;
+    pacerHot.lapCount[s] = crossings;
+    if (crossings > 0) {
+      uint64_t toCrossing = ((uint64_t)crossings << 16) - pacerHot.startPhase[s];
+      pacerHot.lastLapTime[s] = pacerHot.startTime[s] + pacerTimeAt(s, toCrossing);
+    }
+  }
+}
 
+// Parse the pacer list of a START command and arm the pacers to leave
+// their start positions at startTime (now, or a scheduled time).
+// Each pacer is <lap time>,<start meters>,<color>[,<lane>[,<trail meters>[,<length meters>]]]|, where the lap
+// time may instead be a pace profile (see parseProfile) or G<slot> to replay
+// a stored ghost
+void parseStartCommand(StrView cmd, clock_us_t startTime) {
   int pacerIndex = 0;
   int lastPos = 0;
 
@@ -47,52 +251,163 @@ void parseStartCommand(String cmd) {
 
   while (cmd.indexOf('|', lastPos) != -1 && pacerIndex < MAX_PACERS) {
     int pipePos = cmd.indexOf('|', lastPos);
-    String pacerData = cmd.substring(lastPos, pipePos);
+    StrView pacerData = cmd.sub(lastPos, pipePos);
 
     int comma1 = pacerData.indexOf(',');
     int comma2 = pacerData.indexOf(',', comma1 + 1);
 
     if (comma1 != -1 && comma2 != -1) {
-      float timePerLap = pacerData.substring(0, comma1).toFloat();
-      int startMeters = pacerData.substring(comma1 + 1, comma2).toInt();
-      String colorHex = pacerData.substring(comma2 + 1);
+      StrView paceData = pacerData.sub(0, comma1);
+      float timePerLap = paceData.toFloat();
+
+      // A ghost that is not stored makes no pacer (rather than a 1 s lap)
+      GhostTable ghost;
+      bool isGhost = paceData.startsWith("G");
+      if (isGhost && !loadGhost(paceData.sub(1).toInt(), ghost)) {
+        lastPos = pipePos + 1;
+        continue;
+      }
+
+      if (isGhost) {
+        ghostToProfile(ghost, pacers[pacerIndex].profile.spec);
+        compileProfile(pacers[pacerIndex].profile);
+        timePerLap = pacers[pacerIndex].profile.spec.steps[0].fromLapTime;
+      } else if (paceData.indexOf(':') != -1 && parseProfile(paceData, pacers[pacerIndex].profile.spec)) {
+        compileProfile(pacers[pacerIndex].profile);
+        timePerLap = pacers[pacerIndex].profile.spec.steps[0].fromLapTime;
+      } else {
+        pacers[pacerIndex].profile.spec.count = 0;
+      }
+      int startMeters = pacerData.sub(comma1 + 1, comma2).toInt();
+      int comma3 = pacerData.indexOf(',', comma2 + 1);
+      int comma4 = comma3 == -1 ? -1 : pacerData.indexOf(',', comma3 + 1);
+      StrView colorHex = pacerData.sub(comma2 + 1, comma3 == -1 ? pacerData.len : comma3);
+      int lane = comma3 == -1 ? 0 : pacerData.sub(comma3 + 1, comma4 == -1 ? pacerData.len : comma4).toInt();
+      int comma5 = comma4 == -1 ? -1 : pacerData.indexOf(',', comma4 + 1);
+      float trailMeters = comma4 == -1 ? 0 : pacerData.sub(comma4 + 1, comma5 == -1 ? pacerData.len : comma5).toFloat();
+      float lengthMeters = comma5 == -1 ? 0 : pacerData.sub(comma5 + 1).toFloat();
 
       pacers[pacerIndex].enabled = true;
       pacers[pacerIndex].timePerLap = timePerLap;
       pacers[pacerIndex].startPosition = startMeters;
-
-      float unitsPerMeter = (float)LOGICAL_UNITS_PER_SEGMENT / 5.0;
-      pacers[pacerIndex].currentPosition = startMeters * unitsPerMeter;
+      pacers[pacerIndex].lane = (lane >= 0 && lane < NUM_LANES) ? lane : 0;
+      pacers[pacerIndex].trailUnits = constrain(trailMeters * LOGICAL_UNITS_PER_SEGMENT / 5.0, 0, MAX_TRAIL_UNITS);
+      pacers[pacerIndex].bodyUnits = lengthMeters > 0 ? constrain(lengthMeters * LOGICAL_UNITS_PER_SEGMENT / 5.0, 1, MAX_BODY_UNITS) : LEDS_PER_SEGMENT;
       pacers[pacerIndex].color = hexToColor(colorHex);
-      pacers[pacerIndex].lastUpdate = millis();
+      pacers[pacerIndex].startTime = startTime;
 
       pacerIndex++;
     }
 
     lastPos = pipePos + 1;
   }
+
+  activatePacers(true);
 }
 
-// Update pacer positions based on elapsed time
-void updatePacers() {
-  unsigned long now = millis();
+// True while a pacer runs a profile built for the current track length (a
+// ghost); changing the length under it would replay the race at the wrong
+// speeds, so the segment and calibration handlers refuse to
+bool ghostRunning() {
+  if (!systemRunning) return false;
+  for (int s = 0; s < pacerHot.count; s++) {
+    if (pacers[pacerHot.pacer[s]].profile.spec.flags & PROFILE_FIXED_TRACK) return true;
+  }
+  return false;
+}
 
-  for (int i = 0; i < MAX_PACERS; i++) {
-    if (!pacers[i].enabled) continue;
+// True if every ghost a START pacer list names (G<slot>) is stored, so a
+// start naming a missing one can be refused before anything changes
+bool startGhostsExist(StrView cmd) {
+  GhostTable ghost;
+  int lastPos = 0;
+  int pipePos;
 
-    if (pacers[i].timePerLap <= 0) {
-        pacers[i].timePerLap = 1.0;
+  while ((pipePos = cmd.indexOf('|', lastPos)) != -1) {
+    StrView paceData = cmd.sub(lastPos, pipePos);
+    int comma = paceData.indexOf(',');
+    if (comma != -1) paceData = paceData.sub(0, comma);
+    if (paceData.startsWith("G") && !loadGhost(paceData.sub(1).toInt(), ghost)) return false;
+    lastPos = pipePos + 1;
+  }
+  return true;
+}
+
+// True if every start position in a START pacer list lies on its lane's
+// lap (0 up to the lap length), so one off the track is refused before
+// anything changes
+bool startPositionsValid(StrView cmd) {
+  int lastPos = 0;
+  int pipePos;
+
+  while ((pipePos = cmd.indexOf('|', lastPos)) != -1) {
+    StrView pacerData = cmd.sub(lastPos, pipePos);
+    int comma1 = pacerData.indexOf(',');
+    int comma2 = comma1 == -1 ? -1 : pacerData.indexOf(',', comma1 + 1);
+    if (comma2 != -1) {
+      int comma3 = pacerData.indexOf(',', comma2 + 1);
+      int comma4 = comma3 == -1 ? -1 : pacerData.indexOf(',', comma3 + 1);
+      int lane = comma3 == -1 ? 0 : pacerData.sub(comma3 + 1, comma4 == -1 ? pacerData.len : comma4).toInt();
+      if (lane < 0 || lane >= NUM_LANES) lane = 0;
+      long startMeters = pacerData.sub(comma1 + 1, comma2).toInt();
+      if (startMeters < 0 || startMeters > trackMeters + lanes[lane].extraMeters) return false;
     }
+    lastPos = pipePos + 1;
+  }
+  return true;
+}
+
+// Hold the final stretch of a countdown in a busy-wait, so the first moving
+// frame is computed at the scheduled start rather than up to a frame late
+void waitForScheduledStart() {
+  clock_us_t now = trackMicros();
+  if (now >= sessionStartTime || sessionStartTime - now > START_SPIN_WINDOW_US) return;
 
-    unsigned long elapsed = now - pacers[i].lastUpdate;
-    pacers[i].lastUpdate = now;
+  while (trackMicros() < sessionStartTime) {
+  }
+}
+
+// Update pacer positions based on elapsed time
+// Position is computed from the time since startTime rather than accumulated
+// frame by frame, so it cannot drift no matter how long the session runs,
+// and pace profiles are evaluated in closed form.
+// Every finish-line (0m) crossing since the last call is published as a lap
+// event stamped with the exact time it happened, not the time it was noticed.
+// Pacers move at constant speed over the ground; the calibration table turns
+// their lap phase into a position on the strip. timePerLap is the pace over
+// a lane-1 lap, so a lap in an outer lane takes proportionally longer.
+//
+// The kernel is instantiated for each common active pacer count so the
+// compiler can fully unroll it; COUNT 0 is the general loop, only built in
+// when MAX_PACERS allows more pacers than are specialized.
+template<int COUNT>
+void updateKernel(clock_us_t now) {
+  const int count = COUNT ? COUNT : pacerHot.count;
+
+  for (int s = 0; s < count; s++) {
+    // Distance in Q16 laps from the finish line, counting the start offset
+    uint64_t total = pacerTravelled(pacerHot, s, now) + pacerHot.startPhase[s];
 
-    float unitsPerSecond = (float)current_NUM_LEDS / pacers[i].timePerLap;
-    float unitsMoved = unitsPerSecond * (elapsed / 1000.0);
+    uint32_t crossings = total >> 16;
+    if (crossings > pacerHot.lapCount[s]) emitLapEvents(s, crossings);
 
-    pacers[i].currentPosition += unitsMoved;
+    // Lap phase kept in integers until the table lookup
+    pacerHot.phase[s] = (uint32_t)(total & 0xFFFF);
+    pacerHot.head[s] = phaseToUnits16(pacerHot.phase[s]) >> 4;
+  }
+}
 
-    pacers[i].currentPosition = fmod(pacers[i].currentPosition, (float)current_NUM_LEDS);
+void updatePacers() {
+  clock_us_t now = trackMicros();
+
+  switch (pacerHot.count) {
+    case 0: break;
+    case 1: updateKernel<1>(now); break;
+    case 2: updateKernel<2>(now); break;
+    case 3: updateKernel<3>(now); break;
+#if MAX_PACERS > 3
+    default: updateKernel<0>(now); break;
+#endif
   }
 }
 
@@ -0,0 +1,76 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <WiFi.h>
+#include "config.h"
+#include "clock.h"
+
+// Idle power management
+// Between sessions nothing moves, so the loop has no reason to spin at full
+// speed. While idle the CPU runs at IDLE_CPU_MHZ and each pass ends with a
+// short sleep, during which the idle task halts the core until the next
+// tick; the web server and sync socket are polled every IDLE_POLL_MS instead
+// of continuously. Followers, which join the leader as a WiFi station, also
+// let the modem sleep between beacons (an access point cannot).
+//
+// The loop wakes as soon as a session is running (START, START_AT, a
+// leader's start or a resumed session). The time from waking to the first
+// frame going out is measured against WAKE_TARGET_MS; a request that
+// arrives while idle waits up to IDLE_POLL_MS more before it is seen.
+
+bool powerIdle = false;
+bool wakePending = false;         // Woken, first frame not yet out
+clock_us_t wakeTime = 0;
+uint32_t wakeLatencyUs = 0;       // Most recent wake to first frame
+uint32_t wakeLatencyMaxUs = 0;
+clock_us_t lastStationPoll = 0;
+
+void enterIdlePower() {
+  if (powerIdle) return;
+  setCpuFrequencyMhz(IDLE_CPU_MHZ);
+  if (SYNC_ROLE == SYNC_ROLE_FOLLOWER) WiFi.setSleep(true);
+  powerIdle = true;
+}
+
+// Back to full speed for a session
+void wakeFromIdle() {
+  if (!powerIdle) return;
+  wakeTime = clockMicros();
+  setCpuFrequencyMhz(RUN_CPU_MHZ);
+  if (SYNC_ROLE == SYNC_ROLE_FOLLOWER) WiFi.setSleep(false);
+  powerIdle = false;
+  wakePending = true;
+}
+
+// A frame has gone to the strip; the first one after a wake ends the
+// measurement
+void noteFrameShown() {
+  if (!wakePending) return;
+  wakePending = false;
+
+  wakeLatencyUs = clockMicros() - wakeTime;
+  if (wakeLatencyUs > wakeLatencyMaxUs) wakeLatencyMaxUs = wakeLatencyUs;
+
+  if (wakeLatencyUs > WAKE_TARGET_MS * CLOCK_US_PER_MS) {
+    Serial.print("Slow wake: first frame after ");
+    Serial.print(wakeLatencyUs);
+    Serial.println(" us");
+  }
+}
+
+// End an idle loop pass
+void idleWait() {
+  enterIdlePower();
+  delay(IDLE_POLL_MS);
+}
+
+// Whether the station count is due for a refresh; it changes rarely and
+// asking the WiFi driver costs more than the rest of an idle pass
+bool stationPollDue() {
+  clock_us_t now = clockMicros();
+  if (now - lastStationPoll < STATION_POLL_MS * CLOCK_US_PER_MS) return false;
+  lastStationPoll = now;
+  return true;
+}
+
+#endif
@@ -0,0 +1,397 @@
+#ifndef PRESETS_H
+#define PRESETS_H
+
+#include <Preferences.h>
+#include <nvs.h>
+#include "config.h"
+#include "arena.h"
+#include "json_stream.h"
+
+// Presets
+// A preset is a named set of pacer settings from the web page. Each is
+// stored in NVS as one compact binary record in its own slot ("preset<n>"),
+// with the name inside the record, so names are not limited by the length
+// of an NVS key. Presets arrive as JSON documents
+//   {"name":"...","segments":4,"pacers":[{"enabled":true,"time":8.0,
+//    "color":"#FF0000","position":0},...]}
+// and are parsed with the streaming parser straight into a record while the
+// request body is still being received. Unknown members are ignored.
+// Presets from before this layout, JSON strings under "preset_<name>", are
+// moved into slots the first time the library is used (see
+// migrateOldPresets).
+
+struct __attribute__((packed)) PresetPacer {
+  uint8_t enabled;
+  float time;              // Seconds per lap
+  uint8_t r, g, b;
+  int16_t position;        // Start, meters
+};
+
+struct __attribute__((packed)) PresetRecord {
+  char name[PRESET_NAME_LEN];
+  uint8_t segments;
+  uint8_t count;           // Pacers in the preset
+  PresetPacer pacers[MAX_PACERS];
+};
+
+extern Preferences preferences;
+
+// The library lives in one of two banks of slots. A bulk import fills the
+// other bank and then switches banks with a single key write, so an import
+// replaces the whole library or, if it fails part way, changes nothing.
+int presetBank = -1;     // Active bank, read from NVS on first use
+
+void migrateOldPresets();
+
+int activePresetBank() {
+  if (presetBank < 0) {
+    if (!preferences.isKey("presetBank")) migrateOldPresets();
+    presetBank = preferences.getUChar("presetBank", 0) & 1;
+  }
+  return presetBank;
+}
+
+// NVS key of a preset slot in a bank, written into key (12 bytes)
+const char* presetKey(int bank, int slot, char *key) {
+  snprintf(key, 12, bank ? "presetb%d" : "preset%d", slot);
+  return key;
+}
+
+bool loadPresetFrom(int bank, int slot, PresetRecord &record) {
+  char key[12];
+  if (preferences.getBytes(presetKey(bank, slot, key), &record, sizeof(record)) != sizeof(record)) return false;
+  record.name[PRESET_NAME_LEN - 1] = '\0';
+  return record.name[0] != '\0';
+}
+
+bool loadPresetSlot(int slot, PresetRecord &record) {
+  return loadPresetFrom(activePresetBank(), slot, record);
+}
+
+// Slot holding the preset called name, or -1
+int findPreset(const char *name) {
+  PresetRecord record;
+  for (int slot = 0; slot < MAX_PRESETS; slot++) {
+    if (loadPresetSlot(slot, record) && strcmp(record.name, name) == 0) return slot;
+  }
+  return -1;
+}
+
+// Slot to store the preset called name in: its own slot if it exists, else
+// the first free one; -1 when full
+int presetSlotFor(const char *name) {
+  PresetRecord record;
+  int free = -1;
+  for (int slot = 0; slot < MAX_PRESETS; slot++) {
+    if (!loadPresetSlot(slot, record)) {
+      if (free == -1) free = slot;
+    } else if (strcmp(record.name, name) == 0) {
+      return slot;
+    }
+  }
+  return free;
+}
+
+// Store a preset, replacing one of the same name; false when full
+bool storePreset(const PresetRecord &record) {
+  int slot = presetSlotFor(record.name);
+  if (slot < 0) return false;
+
+  char key[12];
+  preferences.putBytes(presetKey(activePresetBank(), slot, key), &record, sizeof(record));
+  return true;
+}
+
+bool deletePreset(const char *name) {
+  int slot = findPreset(name);
+  if (slot < 0) return false;
+
+  char key[12];
+  preferences.remove(presetKey(activePresetBank(), slot, key));
+  return true;
+}
+
+// Write a preset as its JSON document
+void appendPresetJson(TextWriter &out, const PresetRecord &record) {
+  out += "{\"name\":";
+  out.appendQuoted(record.name);
+  out += ",\"segments\":";
+  out += record.segments;
+  out += ",\"pacers\":[";
+
+  for (int i = 0; i < record.count; i++) {
+    const PresetPacer &p = record.pacers[i];
+    char color[8];
+    snprintf(color, sizeof(color), "#%02X%02X%02X", p.r, p.g, p.b);
+
+    if (i > 0) out += ",";
+    out += "{\"enabled\":";
+    out += p.enabled ? "true" : "false";
+    out += ",\"time\":";
+    out.appendFixed(p.time, 2);
+    out += ",\"color\":\"";
+    out += color;
+    out += "\",\"position\":";
+    out += p.position;
+    out += "}";
+  }
+
+  out += "]}";
+}
+
+// Parsing
+// PresetParse collects one preset document into a record. base is the
+// parser depth of the preset object's members (1 for a document that is
+// just a preset).
+struct PresetParse {
+  PresetRecord record;
+  int base;
+  char key[16];            // Member of the preset being read
+  char pacerKey[16];       // Member of the pacer being read
+  bool hasName;
+  bool hasSegments;
+};
+
+void beginPresetParse(PresetParse &parse, int base) {
+  memset(&parse.record, 0, sizeof(parse.record));
+  parse.base = base;
+  parse.key[0] = '\0';
+  parse.pacerKey[0] = '\0';
+  parse.hasName = false;
+  parse.hasSegments = false;
+}
+
+// Feed one parser event for the preset object or anything inside it.
+// Levels count from the preset's members: 0 the preset object and its
+// members, 1 the pacers array, 2 each pacer object and its members.
+void presetEvent(PresetParse &parse, JsonStream &json, JsonEvent event, const char *text) {
+  int level = json.depth - parse.base;
+  bool inPacers = strcmp(parse.key, "pacers") == 0;
+  bool opens = event == JSON_OBJECT_START || event == JSON_ARRAY_START;
+  bool closes = event == JSON_OBJECT_END || event == JSON_ARRAY_END;
+
+  if (level == 0) {
+    if (opens || closes) {
+      if (event == JSON_ARRAY_START) jsonFail(json, "Preset must be an object");
+    } else if (event == JSON_KEY) {
+      strncpy(parse.key, text, sizeof(parse.key) - 1);
+      parse.key[sizeof(parse.key) - 1] = '\0';
+    } else if (strcmp(parse.key, "name") == 0) {
+      if (event != JSON_STRING || strlen(text) == 0 || strlen(text) >= PRESET_NAME_LEN) {
+        jsonFail(json, "Bad preset name");
+        return;
+      }
+      strcpy(parse.record.name, text);
+      parse.hasName = true;
+    } else if (strcmp(parse.key, "segments") == 0) {
+      int segments = atoi(text);
+      if (event != JSON_NUMBER || segments < 1 || segments > MAX_SEGMENTS) {
+        jsonFail(json, "Bad segment count");
+        return;
+      }
+      parse.record.segments = segments;
+      parse.hasSegments = true;
+    } else if (inPacers) {
+      jsonFail(json, "pacers must be an array");
+    }
+  } else if (level == 1 && inPacers) {
+    if (event == JSON_ARRAY_START) {
+      // A repeated pacers member replaces the earlier one, like any other
+      parse.record.count = 0;
+      memset(parse.record.pacers, 0, sizeof(parse.record.pacers));
+    } else if (event != JSON_ARRAY_END) {
+      jsonFail(json, "pacers must be an array of objects");
+    }
+  } else if (level == 2 && inPacers) {
+    if (event == JSON_OBJECT_START) {
+      if (parse.record.count >= MAX_PACERS) {
+        jsonFail(json, "Too many pacers");
+        return;
+      }
+      parse.record.count++;
+      parse.pacerKey[0] = '\0';
+      return;
+    }
+    if (event == JSON_ARRAY_START) {
+      jsonFail(json, "pacers must be an array of objects");
+      return;
+    }
+
+    PresetPacer &p = parse.record.pacers[parse.record.count - 1];
+
+    if (event == JSON_OBJECT_END) {
+      if (p.time <= 0) jsonFail(json, "Pacer has no lap time");
+    } else if (event == JSON_KEY) {
+      strncpy(parse.pacerKey, text, sizeof(parse.pacerKey) - 1);
+      parse.pacerKey[sizeof(parse.pacerKey) - 1] = '\0';
+    } else if (strcmp(parse.pacerKey, "enabled") == 0) {
+      if (event != JSON_TRUE && event != JSON_FALSE) jsonFail(json, "Bad enabled flag");
+      p.enabled = event == JSON_TRUE;
+    } else if (strcmp(parse.pacerKey, "time") == 0) {
+      p.time = atof(text);
+      if (event != JSON_NUMBER || p.time <= 0 || p.time > 3600) jsonFail(json, "Bad lap time");
+    } else if (strcmp(parse.pacerKey, "color") == 0) {
+      char *end;
+      long color = strtol(text + 1, &end, 16);
+      if (event != JSON_STRING || text[0] != '#' || strlen(text) != 7 || *end != '\0') {
+        jsonFail(json, "Bad color");
+        return;
+      }
+      p.r = color >> 16;
+      p.g = color >> 8;
+      p.b = color;
+    } else if (strcmp(parse.pacerKey, "position") == 0) {
+      int position = atoi(text);
+      if (event != JSON_NUMBER || position < 0 || position > MAX_SEGMENTS * 5) jsonFail(json, "Bad start position");
+      p.position = position;
+    }
+  }
+}
+
+// Handler for a document that is a single preset; context is a PresetParse
+void presetDocumentEvent(JsonStream &json, JsonEvent event, const char *text) {
+  presetEvent(*(PresetParse*)json.context, json, event, text);
+}
+
+// Check a parsed preset is complete; NULL if it is, else what is wrong
+const char* presetParseError(const PresetParse &parse) {
+  if (!parse.hasName) return "Preset has no name";
+  if (!parse.hasSegments) return "Preset has no segment count";
+  if (parse.record.count == 0) return "Preset has no pacers";
+  return NULL;
+}
+
+// Bulk import
+// A library is a JSON array of preset documents. Each preset is written to
+// the inactive bank as soon as its object closes, so only one record is
+// held in RAM however long the library is; a later preset with the same
+// name replaces an earlier one.
+struct PresetImport {
+  PresetParse preset;
+  int bank;                // Bank being filled
+  int count;               // Presets written to it so far
+};
+
+void beginPresetImport(PresetImport &import) {
+  beginPresetParse(import.preset, 2);
+  import.bank = activePresetBank() ^ 1;
+  import.count = 0;
+}
+
+// Write a parsed preset to the bank being filled
+void importPreset(PresetImport &import, JsonStream &json) {
+  const PresetRecord &record = import.preset.record;
+  PresetRecord existing;
+  int slot = 0;
+  while (slot < import.count && !(loadPresetFrom(import.bank, slot, existing) && strcmp(existing.name, record.name) == 0)) {
+    slot++;
+  }
+
+  if (slot == import.count) {
+    if (import.count >= MAX_PRESETS) {
+      jsonFail(json, "Too many presets");
+      return;
+    }
+    import.count++;
+  }
+
+  char key[12];
+  preferences.putBytes(presetKey(import.bank, slot, key), &record, sizeof(record));
+}
+
+// Handler for a library document; context is a PresetImport
+void presetLibraryEvent(JsonStream &json, JsonEvent event, const char *text) {
+  PresetImport &import = *(PresetImport*)json.context;
+
+  if (json.depth <= 1) {
+    if (event != JSON_ARRAY_START && event != JSON_ARRAY_END) jsonFail(json, "Library must be an array of presets");
+    return;
+  }
+
+  // Every element must be a preset object. Scalar elements are caught
+  // above; an array element opens at depth 2 and must not reach
+  // presetEvent, which would take it for the preset's own members.
+  if (json.depth == 2 && (event == JSON_ARRAY_START || event == JSON_ARRAY_END)) {
+    jsonFail(json, "Library must be an array of presets");
+    return;
+  }
+
+  if (json.depth == 2 && event == JSON_OBJECT_START) beginPresetParse(import.preset, 2);
+  presetEvent(import.preset, json, event, text);
+
+  if (json.depth == 2 && event == JSON_OBJECT_END && !json.error) {
+    const char *error = presetParseError(import.preset);
+    if (error) {
+      jsonFail(json, error);
+    } else {
+      importPreset(import, json);
+    }
+  }
+}
+
+// Make a completely imported library the active one and drop the old one
+void commitPresetImport(PresetImport &import) {
+  char key[12];
+  for (int slot = import.count; slot < MAX_PRESETS; slot++) {
+    if (preferences.isKey(presetKey(import.bank, slot, key))) preferences.remove(key);
+  }
+
+  preferences.putUChar("presetBank", import.bank);
+  int old = presetBank;
+  presetBank = import.bank;
+
+  for (int slot = 0; slot < MAX_PRESETS; slot++) {
+    if (preferences.isKey(presetKey(old, slot, key))) preferences.remove(key);
+  }
+}
+
+// Migration
+// Presets used to be stored as the page's JSON document, without the name,
+// in a string under "preset_<name>". Runs once, before presetBank is first
+// written: each old preset that still parses is stored in bank 0 and its
+// old key removed. NVS keys are at most 15 characters, so old names fit a
+// record; presets past MAX_PRESETS are left where they were.
+#define OLD_PRESET_PREFIX "preset_"
+#define OLD_PRESET_MAX_LEN 1024
+
+void migrateOldPresets() {
+  char oldKeys[MAX_PRESETS][NVS_KEY_NAME_MAX_SIZE];
+  int count = 0;
+
+  // Collect the keys first; writing while iterating would disturb the iterator
+  nvs_iterator_t it = NULL;
+  esp_err_t err = nvs_entry_find(NVS_DEFAULT_PART_NAME, PREFS_NAMESPACE, NVS_TYPE_STR, &it);
+  while (err == ESP_OK && count < MAX_PRESETS) {
+    nvs_entry_info_t info;
+    nvs_entry_info(it, &info);
+    if (strncmp(info.key, OLD_PRESET_PREFIX, strlen(OLD_PRESET_PREFIX)) == 0) {
+      strcpy(oldKeys[count++], info.key);
+    }
+    err = nvs_entry_next(&it);
+  }
+  nvs_release_iterator(it);
+
+  char data[OLD_PRESET_MAX_LEN];
+  int slot = 0;
+  for (int k = 0; k < count && slot < MAX_PRESETS; k++) {
+    PresetParse parse;
+    beginPresetParse(parse, 1);
+    JsonStream json;
+    jsonBegin(json, presetDocumentEvent, &parse);
+
+    size_t len = preferences.getString(oldKeys[k], data, sizeof(data));
+    if (len > 0 && jsonFeed(json, data, strlen(data)) && jsonFinish(json)) {
+      strcpy(parse.record.name, oldKeys[k] + strlen(OLD_PRESET_PREFIX));
+      parse.hasName = parse.record.name[0] != '\0';
+      if (!presetParseError(parse)) {
+        char key[12];
+        preferences.putBytes(presetKey(0, slot++, key), &parse.record, sizeof(parse.record));
+        preferences.remove(oldKeys[k]);
+      }
+    }
+  }
+
+  preferences.putUChar("presetBank", 0);
+}
+
+#endif
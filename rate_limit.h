@@ -0,0 +1,72 @@
+#ifndef RATE_LIMIT_H
+#define RATE_LIMIT_H
+
+#include "config.h"
+#include "clock.h"
+#include "request_server.h"
+
+// Client admission control
+// The web server answers one request per loop pass, between frames, so a
+// phone polling flat out steals time from rendering and from the buttons on
+// every other phone. Control routes (/command, /segments, ...) are always
+// served. Polls (/status, /events) must take a token from the client's own
+// bucket and from a shared one, and are turned away with a 429 when either
+// is empty, so under load polls are shed and control requests still get
+// through. The number of stations is capped at the access point (MAX_CLIENTS).
+
+struct ClientBucket {
+  uint32_t ip;           // 0 = free
+  float tokens;
+  clock_us_t lastSeen;
+};
+
+extern RequestServer server;
+
+ClientBucket clientBuckets[MAX_CLIENTS * 2];  // Room for stations that reconnected
+float pollTokens = POLL_TOTAL_BURST;
+clock_us_t pollTokensAt = 0;
+uint32_t pollsRejected = 0;
+
+// Refill a bucket at rate tokens per second up to burst, then take one
+bool takeToken(float &tokens, clock_us_t &last, clock_us_t now, float rate, float burst) {
+  tokens += (now - last) * rate / CLOCK_US_PER_SEC;
+  if (tokens > burst) tokens = burst;
+  last = now;
+
+  if (tokens < 1) return false;
+  tokens -= 1;
+  return true;
+}
+
+// Bucket for a client address, reusing the least recently seen one when full
+ClientBucket& clientBucket(uint32_t ip, clock_us_t now) {
+  int oldest = 0;
+
+  for (int i = 0; i < MAX_CLIENTS * 2; i++) {
+    if (clientBuckets[i].ip == ip) return clientBuckets[i];
+    if (clientBuckets[i].lastSeen < clientBuckets[oldest].lastSeen) oldest = i;
+  }
+
+  clientBuckets[oldest].ip = ip;
+  clientBuckets[oldest].tokens = POLL_CLIENT_BURST;
+  clientBuckets[oldest].lastSeen = now;
+  return clientBuckets[oldest];
+}
+
+// Admit a poll request, or answer it with 429 and return false
+bool admitPoll() {
+  clock_us_t now = clockMicros();
+  ClientBucket &bucket = clientBucket((uint32_t)server.client().remoteIP(), now);
+
+  if (takeToken(bucket.tokens, bucket.lastSeen, now, POLL_CLIENT_RATE, POLL_CLIENT_BURST) &&
+      takeToken(pollTokens, pollTokensAt, now, POLL_TOTAL_RATE, POLL_TOTAL_BURST)) {
+    return true;
+  }
+
+  pollsRejected++;
+  server.sendHeader("Retry-After", "1");
+  server.send(429, "text/plain", "Too many requests");
+  return false;
+}
+
+#endif
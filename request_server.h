@@ -0,0 +1,35 @@
+#ifndef REQUEST_SERVER_H
+#define REQUEST_SERVER_H
+
+#include <WebServer.h>
+
+// Web server with allocation-free access to the request
+// WebServer::arg() and header() return String copies, which allocate on
+// every call. Handlers find the values the server already holds instead,
+// and copy what they keep into the request arena (see arena.h).
+
+class RequestServer : public WebServer {
+public:
+  RequestServer(int port) : WebServer(port) {}
+
+  // Value of query or body argument name, NULL if the request has none
+  const String* findArg(const char *name) const {
+    for (int i = 0; i < _postArgsLen; i++) {
+      if (strcmp(_postArgs[i].key.c_str(), name) == 0) return &_postArgs[i].value;
+    }
+    for (int i = 0; i < _currentArgCount; i++) {
+      if (strcmp(_currentArgs[i].key.c_str(), name) == 0) return &_currentArgs[i].value;
+    }
+    return NULL;
+  }
+
+  // Value of a collected header (any case), NULL if the request has none
+  const String* findHeader(const char *name) const {
+    for (int i = 0; i < _headerKeysCount; i++) {
+      if (strcasecmp(_currentHeaders[i].key.c_str(), name) == 0) return &_currentHeaders[i].value;
+    }
+    return NULL;
+  }
+};
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef SACN_H
+#define SACN_H
+
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include "config.h"
+#include "clock.h"
+
+// E1.31 (sACN) output
+// Venues with network pixel controllers can take the pixels over WiFi
+// instead of, or as well as, the locally wired strips. Each lane's buffer is
+// split into universes of 170 RGB pixels, starting at SACN_FIRST_UNIVERSE
+// for lane 1, and each universe is sent to its E1.31 multicast group.
+//
+// One complete packet per universe is preallocated and its headers filled in
+// once. Each frame, pixels are packed straight into the packets' DMP data,
+// and only universes whose data changed are sent (plus a keep-alive resend,
+// since receivers drop a source that goes quiet).
+
+#define SACN_PORT 5568
+#define SACN_PIXELS_PER_UNIVERSE 170
+#define SACN_UNIVERSES_PER_LANE ((MAX_LOGICAL_LEDS + SACN_PIXELS_PER_UNIVERSE - 1) / SACN_PIXELS_PER_UNIVERSE)
+#define SACN_UNIVERSES (NUM_LANES * SACN_UNIVERSES_PER_LANE)
+
+// Full E1.31 data packet; multi-byte fields are big-endian
+struct __attribute__((packed)) SacnPacket {
+  // Root layer
+  uint16_t preambleSize;
+  uint16_t postambleSize;
+  uint8_t packetId[12];
+  uint16_t rootFlagsLength;
+  uint32_t rootVector;
+  uint8_t cid[16];
+  // Framing layer
+  uint16_t frameFlagsLength;
+  uint32_t frameVector;
+  char sourceName[64];
+  uint8_t priority;
+  uint16_t syncAddress;
+  uint8_t sequence;
+  uint8_t options;
+  uint16_t universe;
+  // DMP layer
+  uint16_t dmpFlagsLength;
+  uint8_t dmpVector;
+  uint8_t addressType;
+  uint16_t firstAddress;
+  uint16_t addressIncrement;
+  uint16_t valueCount;
+  uint8_t startCode;
+  uint8_t data[512];
+};
+
+static_assert(sizeof(SacnPacket) == 638, "E1.31 data packet is 638 bytes");
+
+// Only the 510 slots of 170 pixels are sent, so a packet on the wire stops
+// two bytes short of the struct; the layer lengths and value count are
+// worked out for what is sent
+#define SACN_SLOTS (SACN_PIXELS_PER_UNIVERSE * 3)
+#define SACN_PACKET_BYTES (offsetof(SacnPacket, data) + SACN_SLOTS)
+
+extern CRGB leds[NUM_LANES][MAX_LOGICAL_LEDS];
+
+uint32_t sacnUniversesSent = 0;
+
+#if SACN_ENABLED
+WiFiUDP sacnUdp;
+SacnPacket sacnPackets[SACN_UNIVERSES];
+clock_us_t sacnSentAt[SACN_UNIVERSES];
+
+inline uint16_t be16(uint16_t x) {
+  return (x >> 8) | (x << 8);
+}
+
+inline uint32_t be32(uint32_t x) {
+  return ((uint32_t)be16(x) << 16) | be16(x >> 16);
+}
+
+// Fill in every packet's fixed fields
+void beginSacn() {
+  for (int u = 0; u < SACN_UNIVERSES; u++) {
+    SacnPacket &p = sacnPackets[u];
+    memset(&p, 0, sizeof(p));
+
+    p.preambleSize = be16(0x0010);
+    memcpy(p.packetId, "ASC-E1.17\0\0\0", 12);
+    p.rootFlagsLength = be16(0x7000 | (SACN_PACKET_BYTES - offsetof(SacnPacket, rootFlagsLength)));
+    p.rootVector = be32(0x00000004);
+    memcpy(p.cid, "TrackPacerNode", 14);
+    p.cid[15] = NODE_FIRST_SEGMENT;
+
+    p.frameFlagsLength = be16(0x7000 | (SACN_PACKET_BYTES - offsetof(SacnPacket, frameFlagsLength)));
+    p.frameVector = be32(0x00000002);
+    strncpy(p.sourceName, AP_SSID, sizeof(p.sourceName) - 1);
+    p.priority = 100;
+    p.universe = be16(SACN_FIRST_UNIVERSE + u);
+
+    p.dmpFlagsLength = be16(0x7000 | (SACN_PACKET_BYTES - offsetof(SacnPacket, dmpFlagsLength)));
+    p.dmpVector = 0x02;
+    p.addressType = 0xA1;
+    p.addressIncrement = be16(1);
+    p.valueCount = be16(1 + SACN_SLOTS);  // Start code and slots
+  }
+
+  sacnUdp.begin(SACN_PORT);
+}
+
+// Pack one universe's pixels into its packet; true if any channel changed
+bool packUniverse(int u) {
+  int lane = u / SACN_UNIVERSES_PER_LANE;
+  int first = (u % SACN_UNIVERSES_PER_LANE) * SACN_PIXELS_PER_UNIVERSE;
+  int count = min(SACN_PIXELS_PER_UNIVERSE, MAX_LOGICAL_LEDS - first);
+  const uint8_t *src = (const uint8_t*)&leds[lane][first];
+  uint8_t *dst = sacnPackets[u].data;
+
+  if (memcmp(dst, src, count * 3) == 0) return false;
+  memcpy(dst, src, count * 3);
+  return true;
+}
+
+// Send the universes that changed in the frame just pushed
+void sendSacn() {
+  clock_us_t now = clockMicros();
+
+  for (int u = 0; u < SACN_UNIVERSES; u++) {
+    if (!packUniverse(u) && now - sacnSentAt[u] < SHOW_KEEPALIVE_MS * CLOCK_US_PER_MS) continue;
+
+    SacnPacket &p = sacnPackets[u];
+    p.sequence++;
+
+    uint16_t universe = SACN_FIRST_UNIVERSE + u;
+    sacnUdp.beginPacket(IPAddress(239, 255, universe >> 8, universe & 0xFF), SACN_PORT);
+    sacnUdp.write((const uint8_t*)&p, SACN_PACKET_BYTES);
+    sacnUdp.endPacket();
+
+    sacnSentAt[u] = now;
+    sacnUniversesSent++;
+  }
+}
+
+#else
+void beginSacn() {}
+void sendSacn() {}
+#endif
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef SESSION_LOG_H
+#define SESSION_LOG_H
+
+#include <LittleFS.h>
+#include "config.h"
+#include "clock.h"
+#include "events.h"
+#include "pacer.h"
+#include "arena.h"
+
+// Session log
+// Starts, stops, pacer settings and every lap crossing are appended to a log
+// on the flash filesystem as fixed 16-byte records, so a session can be
+// reviewed after the phones have gone home. Records collect in a RAM
+// staging buffer and are written a page at a time, which keeps flash writes
+// rare and out of most frames. When the log reaches LOG_MAX_BYTES it becomes
+// the old log and a new one is started, so two logs' worth is kept.
+
+#define LOG_PATH "/session.log"
+#define LOG_OLD_PATH "/session.old"
+
+// Record types
+#define LOG_START 1        // arg = segments, value = active pacers
+#define LOG_STOP 2
+#define LOG_PACER 3        // arg = start meters, value = lap time in ms
+#define LOG_LAP 4          // arg = lap, value = split in microseconds
+#define LOG_LAP_PARTIAL 5  // As LOG_LAP, for a first lap from a start away from 0m
+
+struct __attribute__((packed)) LogRecord {
+  uint64_t time;     // Track clock, microseconds
+  uint8_t type;
+  uint8_t pacer;
+  uint16_t arg;
+  uint32_t value;
+};
+
+static_assert(LOG_PAGE_SIZE % sizeof(LogRecord) == 0, "Log pages must hold whole records");
+
+#define LOG_PAGE_RECORDS (LOG_PAGE_SIZE / sizeof(LogRecord))
+
+extern int TOTAL_SEGMENTS;
+extern clock_us_t sessionStartTime;
+
+bool logReady = false;
+LogRecord logStaging[LOG_PAGE_RECORDS];
+int logStaged = 0;
+uint32_t logEventCursor = 0;  // Last lap event seq logged
+
+void beginLog() {
+  logReady = LittleFS.begin(true);
+  logEventCursor = latestLapEventSeq();
+}
+
+// Write the staging buffer to the log
+void flushLog() {
+  if (!logReady || logStaged == 0) return;
+
+  File file = LittleFS.open(LOG_PATH, FILE_APPEND);
+  if (file && file.size() + logStaged * sizeof(LogRecord) > LOG_MAX_BYTES) {
+    file.close();
+    LittleFS.remove(LOG_OLD_PATH);
+    LittleFS.rename(LOG_PATH, LOG_OLD_PATH);
+    file = LittleFS.open(LOG_PATH, FILE_APPEND);
+  }
+
+  if (file) {
+    file.write((const uint8_t*)logStaging, logStaged * sizeof(LogRecord));
+    file.close();
+  }
+  logStaged = 0;
+}
+
+void logRecord(uint8_t type, uint8_t pacer, uint16_t arg, uint32_t value, clock_us_t time) {
+  if (!logReady) return;
+
+  LogRecord &r = logStaging[logStaged++];
+  r.time = time;
+  r.type = type;
+  r.pacer = pacer;
+  r.arg = arg;
+  r.value = value;
+
+  if (logStaged == (int)LOG_PAGE_RECORDS) flushLog();
+}
+
+// Log a START and the settings of every pacer in it
+void logSessionStart() {
+  logRecord(LOG_START, 0, TOTAL_SEGMENTS, pacerHot.count, sessionStartTime);
+
+  for (int i = 0; i < MAX_PACERS; i++) {
+    if (!pacers[i].enabled) continue;
+    logRecord(LOG_PACER, i, pacers[i].startPosition, (uint32_t)(pacers[i].timePerLap * 1000 + 0.5), sessionStartTime);
+  }
+}
+
+// Log a STOP; the session is over, so write everything out now
+void logSessionStop() {
+  logRecord(LOG_STOP, 0, 0, 0, trackMicros());
+  flushLog();
+}
+
+// Log lap events published since the last call. Called from the loop, so the
+// frame code only ever writes to the lap event ring.
+void logLapEvents() {
+  uint32_t head = latestLapEventSeq();
+  if (head - logEventCursor > EVENT_RING_SIZE) logEventCursor = head - EVENT_RING_SIZE;
+
+  while (logEventCursor < head) {
+    LapEvent e;
+    logEventCursor++;
+    if (!readLapEvent(logEventCursor, e)) continue;
+
+    uint8_t type = (e.flags & LAP_EVENT_PARTIAL) ? LOG_LAP_PARTIAL : LOG_LAP;
+    logRecord(type, e.pacer, e.lap, e.splitMicros, e.timestamp);
+  }
+}
+
+// Append one record to out as a line of
+// time_s,event,pacer,lap,split_s,lap_time_s,start_m,segments
+void appendLogCsv(TextWriter &out, const LogRecord &r) {
+  out.appendFixed(r.time / 1e6, 6);
+
+  switch (r.type) {
+    case LOG_START:
+      out += ",start,,,,,,";
+      out += r.arg;
+      break;
+    case LOG_STOP:
+      out += ",stop,,,,,,";
+      break;
+    case LOG_PACER:
+      out += ",pacer,";
+      out += r.pacer + 1;
+      out += ",,,";
+      out.appendFixed(r.value / 1000.0, 3);
+      out += ",";
+      out += r.arg;
+      out += ",";
+      break;
+    case LOG_LAP:
+    case LOG_LAP_PARTIAL:
+      out += r.type == LOG_LAP ? ",lap," : ",partial_lap,";
+      out += r.pacer + 1;
+      out += ",";
+      out += r.arg;
+      out += ",";
+      out.appendFixed(r.value / 1e6, 3);
+      out += ",,,";
+      break;
+    default:
+      out += ",unknown,,,,,,";
+      break;
+  }
+  out += "\n";
+}
+
+#endif
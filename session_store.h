@@ -0,0 +1,109 @@
+#ifndef SESSION_STORE_H
+#define SESSION_STORE_H
+
+#include <Preferences.h>
+#include "config.h"
+#include "clock.h"
+#include "pacer.h"
+#include "led_control.h"
+
+// Session persistence
+// The active configuration is snapshotted on every change, so a controller
+// that reboots mid-practice can light the strip again before WiFi is up.
+// Two copies are kept:
+//  - RTC memory survives resets (brownout, watchdog, crash) and also holds
+//    the session time as of the last frame, so pacers resume in phase with
+//    their lap counts (or a countdown resumes where it was).
+//  - NVS survives a full power loss; pacers then restart from their start
+//    positions with the same configuration.
+
+#define SESSION_MAGIC 0x53455353  // "SSES"
+
+struct SessionSnapshot {
+  uint32_t magic;
+  uint8_t running;
+  uint8_t segments;
+  PacerConfig pacers[MAX_PACERS];
+  uint32_t checksum;
+};
+
+extern Preferences preferences;
+extern bool systemRunning;
+extern clock_us_t sessionStartTime;
+
+RTC_NOINIT_ATTR SessionSnapshot rtcSession;
+RTC_NOINIT_ATTR int64_t rtcSessionElapsed;       // Session time at the last frame (negative in a countdown)
+RTC_NOINIT_ATTR int64_t rtcSessionElapsedCheck;  // ~rtcSessionElapsed when valid
+
+uint32_t sessionChecksum(const SessionSnapshot &snapshot) {
+  const uint8_t *bytes = (const uint8_t*)&snapshot;
+  uint32_t hash = 2166136261u;  // FNV-1a
+
+  for (size_t i = 0; i < offsetof(SessionSnapshot, checksum); i++) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+
+// Record how far into the session we are, or how long a scheduled start
+// has to go; just two RTC memory writes, cheap enough to do every frame
+void checkpointSession(clock_us_t now) {
+  int64_t elapsed = (int64_t)(now - sessionStartTime);
+  rtcSessionElapsed = elapsed;
+  rtcSessionElapsedCheck = ~elapsed;
+}
+
+// Snapshot the current configuration to RTC memory and NVS
+void saveSession() {
+  SessionSnapshot snapshot;
+  memset(&snapshot, 0, sizeof(snapshot));
+  snapshot.magic = SESSION_MAGIC;
+  snapshot.running = systemRunning;
+  snapshot.segments = TOTAL_SEGMENTS;
+
+  for (int i = 0; i < MAX_PACERS; i++) {
+    packPacerConfig(pacers[i], snapshot.pacers[i]);
+  }
+  snapshot.checksum = sessionChecksum(snapshot);
+
+  rtcSession = snapshot;
+  checkpointSession(systemRunning ? trackMicros() : sessionStartTime);
+  preferences.putBytes("session", &snapshot, sizeof(snapshot));
+}
+
+// Restore the last snapshot at boot; returns true if pacing should resume
+bool restoreSession() {
+  SessionSnapshot snapshot;
+  int64_t elapsed = 0;
+
+  if (rtcSession.magic == SESSION_MAGIC && rtcSession.checksum == sessionChecksum(rtcSession)) {
+    snapshot = rtcSession;
+    if (rtcSessionElapsedCheck == ~rtcSessionElapsed) elapsed = rtcSessionElapsed;
+  } else if (preferences.getBytes("session", &snapshot, sizeof(snapshot)) != sizeof(snapshot) ||
+             snapshot.magic != SESSION_MAGIC || snapshot.checksum != sessionChecksum(snapshot)) {
+    return false;
+  }
+
+  if (snapshot.segments < 1 || snapshot.segments > MAX_SEGMENTS) return false;
+
+  systemRunning = snapshot.running;
+  TOTAL_SEGMENTS = snapshot.segments;
+  current_NUM_LEDS = TOTAL_SEGMENTS * LOGICAL_UNITS_PER_SEGMENT;
+  buildCalibration();
+  buildBackground();
+
+  // Clocks restart at zero on boot; move the track clock forward by the time
+  // already run so the resumed session start stays representable. A
+  // countdown carries on with the time it had left.
+  if (elapsed > 0) trackClockOffset += elapsed;
+  sessionStartTime = trackMicros() - elapsed;
+
+  for (int i = 0; i < MAX_PACERS; i++) {
+    unpackPacerConfig(snapshot.pacers[i], pacers[i], sessionStartTime);
+  }
+  activatePacers(true);
+  resumeLapCounts(trackMicros());
+  return systemRunning;
+}
+
+#endif
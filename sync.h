@@ -0,0 +1,182 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include "config.h"
+#include "clock.h"
+#include "pacer.h"
+#include "led_control.h"
+
+// Multi-controller synchronization
+// A full-length track is driven by several controllers, each wired to its own
+// stretch of strip. The leader owns the web interface and broadcasts its
+// track clock, the session start epoch, the track geometry (length,
+// calibration and lanes) and every pacer's motion parameters.
+// Followers lock their track clock to the leader's and compute the same
+// global positions, rendering only their own segment range.
+
+#define SYNC_MAGIC 0x50434553  // "SECP"
+
+struct __attribute__((packed)) SyncPacket {
+  uint32_t magic;
+  uint32_t seq;
+  uint32_t configGen;      // Bumped whenever pacers or track geometry change
+  uint64_t trackTime;      // Leader track clock when the packet was sent
+  uint64_t sessionStart;
+  uint8_t running;
+  uint8_t segments;
+  uint16_t segmentMm[MAX_SEGMENTS];  // Calibrated segment lengths
+  Lane lanes[NUM_LANES];
+  PacerConfig pacers[MAX_PACERS];
+};
+
+// Only sent when syncing, so a standalone build may have more pacers
+static_assert(SYNC_ROLE == SYNC_ROLE_STANDALONE || sizeof(SyncPacket) <= 1472,
+              "Sync packet must fit in one UDP datagram");
+
+extern bool systemRunning;
+extern clock_us_t sessionStartTime;
+
+WiFiUDP syncUdp;
+uint32_t syncSeq = 0;
+uint32_t syncConfigGen = 0;
+uint32_t syncAppliedGen = 0xFFFFFFFF;
+clock_us_t lastSyncBroadcast = 0;
+
+// Follower clock offset estimates; the largest is the one with the least
+// network delay in it
+int64_t syncOffsetSamples[SYNC_OFFSET_WINDOW];
+int syncOffsetCount = 0;
+int syncOffsetNext = 0;
+
+void beginSync() {
+  if (SYNC_ROLE == SYNC_ROLE_STANDALONE) return;
+  syncUdp.begin(SYNC_PORT);
+}
+
+// Broadcast the leader's state
+void sendSyncPacket() {
+  SyncPacket packet;
+  packet.magic = SYNC_MAGIC;
+  packet.seq = ++syncSeq;
+  packet.configGen = syncConfigGen;
+  packet.sessionStart = sessionStartTime;
+  packet.running = systemRunning;
+  packet.segments = TOTAL_SEGMENTS;
+  for (int k = 0; k < MAX_SEGMENTS; k++) {
+    packet.segmentMm[k] = segmentMillimeters(segmentMeters[k]);
+  }
+  memcpy(packet.lanes, lanes, sizeof(lanes));
+
+  for (int i = 0; i < MAX_PACERS; i++) {
+    packPacerConfig(pacers[i], packet.pacers[i]);
+  }
+
+  syncUdp.beginPacket(WiFi.softAPBroadcastIP(), SYNC_PORT);
+  packet.trackTime = trackMicros();  // Stamp as late as possible
+  syncUdp.write((const uint8_t*)&packet, sizeof(packet));
+  syncUdp.endPacket();
+
+  lastSyncBroadcast = clockMicros();
+}
+
+// Called whenever the leader's pacer configuration or track geometry changes,
+// so followers pick it up without waiting for the next periodic packet
+void syncConfigChanged() {
+  syncConfigGen++;
+  if (SYNC_ROLE == SYNC_ROLE_LEADER) sendSyncPacket();
+}
+
+// Move the follower's track clock towards the leader's. The estimate
+// drops whenever its best sample ages out of the window, and a track clock
+// that stepped back would move every pacer's head back a unit, which
+// rendering takes for a lap's worth of travel. So the offset moves forward
+// at once but is slewed back at SYNC_MAX_SLEW_PPM; only an error beyond
+// SYNC_STEP_US (a restarted leader) is stepped, with the frame redrawn.
+void adjustClockOffset(int64_t target) {
+  int64_t ahead = trackClockOffset - trackClockSlewed(clockMicros()) - target;
+
+  if (syncOffsetCount == 1 || ahead <= 0) {
+    setTrackClockOffset(target);
+  } else if (ahead > SYNC_STEP_US) {
+    setTrackClockOffset(target);
+    resetFrame();
+  } else {
+    slewTrackClock(ahead, SYNC_MAX_SLEW_PPM);
+  }
+}
+
+// Apply a leader packet on a follower
+void applySyncPacket(const SyncPacket &packet, clock_us_t receivedAt) {
+  syncOffsetSamples[syncOffsetNext] = (int64_t)(packet.trackTime - receivedAt);
+  syncOffsetNext = (syncOffsetNext + 1) % SYNC_OFFSET_WINDOW;
+  if (syncOffsetCount < SYNC_OFFSET_WINDOW) syncOffsetCount++;
+
+  int64_t best = syncOffsetSamples[0];
+  for (int i = 1; i < syncOffsetCount; i++) {
+    if (syncOffsetSamples[i] > best) best = syncOffsetSamples[i];
+  }
+  adjustClockOffset(best);
+
+  // Markings come and go with the session, so this is settled before any
+  // frame is restarted
+  bool wasRunning = systemRunning;
+  systemRunning = packet.running;
+
+  if (packet.configGen != syncAppliedGen) {
+    // A change within the same session (the leader's track geometry) keeps
+    // pacers where they are, as it did on the leader
+    bool restart = packet.sessionStart != sessionStartTime;
+
+    bool geometry = packet.segments != TOTAL_SEGMENTS || memcmp(packet.lanes, lanes, sizeof(lanes)) != 0;
+    for (int k = 0; k < MAX_SEGMENTS; k++) {
+      if (packet.segmentMm[k] != segmentMillimeters(segmentMeters[k])) geometry = true;
+    }
+
+    if (geometry) {
+      TOTAL_SEGMENTS = packet.segments;
+      current_NUM_LEDS = TOTAL_SEGMENTS * LOGICAL_UNITS_PER_SEGMENT;
+      for (int k = 0; k < MAX_SEGMENTS; k++) {
+        segmentMeters[k] = packet.segmentMm[k] / 1000.0f;
+      }
+      memcpy(lanes, packet.lanes, sizeof(lanes));
+      buildCalibration();
+      buildBackground();
+    } else {
+      resetFrame();
+    }
+
+    for (int i = 0; i < MAX_PACERS; i++) {
+      unpackPacerConfig(packet.pacers[i], pacers[i], packet.sessionStart);
+    }
+    activatePacers(restart);
+    syncAppliedGen = packet.configGen;
+  }
+
+  sessionStartTime = packet.sessionStart;
+  if (systemRunning != wasRunning) {
+    resetFrame();
+  }
+}
+
+// Per-loop sync work: leaders broadcast periodically, followers drain
+// every packet that has arrived
+void handleSync() {
+  if (SYNC_ROLE == SYNC_ROLE_LEADER) {
+    if (clockMicros() - lastSyncBroadcast >= SYNC_INTERVAL_MS * CLOCK_US_PER_MS) {
+      sendSyncPacket();
+    }
+  } else if (SYNC_ROLE == SYNC_ROLE_FOLLOWER) {
+    SyncPacket packet;
+    int size;
+    while ((size = syncUdp.parsePacket()) > 0) {
+      clock_us_t receivedAt = clockMicros();
+      if (size != sizeof(packet)) continue;
+      syncUdp.read((uint8_t*)&packet, sizeof(packet));
+      if (packet.magic == SYNC_MAGIC) applySyncPacket(packet, receivedAt);
+    }
+  }
+}
+
+#endif
@@ -735,6 +735,10 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
                 <button class="btn-stop" id="stopBtn">STOP</button>
             </div>
 
+            <div class="preset-controls" style="margin-bottom: 20px;">
+                <button onclick="window.location.href = '/log.csv'" style="flex: 1; background: #0ea5e9;">Download Session Log</button>
+            </div>
+
             <div class="preset-section">
                 <h3>Presets</h3>
                 <div class="preset-controls">
@@ -746,6 +750,11 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
                     <input type="file" id="importFile" accept=".json" style="display:none" onchange="importPresetFile(event)">
                     <button onclick="document.getElementById('importFile').click()" style="flex: 1; background: #8b5cf6;">Import File</button>
                 </div>
+                <div class="preset-controls" style="margin-top: 10px;">
+                    <button onclick="window.location.href = '/presets/export'" style="flex: 1; background: #6366f1;">Export All</button>
+                    <input type="file" id="importLibrary" accept=".json" style="display:none" onchange="importPresetLibrary(event)">
+                    <button onclick="document.getElementById('importLibrary').click()" style="flex: 1; background: #8b5cf6;">Import All</button>
+                </div>
                 <div class="preset-list" id="presetList"></div>
             </div>
         </div>
@@ -970,11 +979,18 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
         let currentSegments = 1;
         let isRunning = false;
         let statusCheckInterval;
+        let statusSeq = 0;
         let pacerPositions = [];
-        let startTime = null;
+        let trackMeters = null;
+        let startTime = null;      // Session start on the controller clock (us)
+        let clockOffset = 0;       // Controller clock minus local clock (us)
+        let clockSynced = false;
+        const START_LEAD_MS = 3000;
         let elapsedInterval = null;
         let lapCounts = [0, 0, 0];
-        let lastPositions = [0, 0, 0];
+        let fastestSplit = null;
+        let eventCursor = null;
+        let eventsPending = false;
 
         function togglePacerCard(cardNum) {
             const card = document.getElementById(`pacerCard${cardNum}`);
@@ -1001,12 +1017,6 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
                 stopBtn.classList.add('active');
                 statsDisplay.classList.add('active');
 
-                if (!startTime) {
-                    startTime = Date.now();
-                    lapCounts = [0, 0, 0];
-                    lastPositions = [0, 0, 0];
-                }
-
                 if (!elapsedInterval) {
                     elapsedInterval = setInterval(updateElapsedTime, 100);
                 }
@@ -1026,7 +1036,12 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
         function updateElapsedTime() {
             if (!startTime) return;
 
-            const elapsed = Date.now() - startTime;
+            const elapsed = (controllerNow() - startTime) / 1000;
+            if (elapsed < 0) {
+                document.getElementById('elapsedTime').textContent = '-' + Math.ceil(-elapsed / 1000);
+                return;
+            }
+
             const minutes = Math.floor(elapsed / 60000);
             const seconds = Math.floor((elapsed % 60000) / 1000);
 
@@ -1034,33 +1049,69 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
                 `${String(minutes).padStart(2, '0')}:${String(seconds).padStart(2, '0')}`;
         }
 
-        function updateLapCounts() {
-            const trackLength = currentSegments * 5;
-            let fastestLap = null;
-
-            for (let i = 0; i < pacerPositions.length; i++) {
-                if (!pacerPositions[i].enabled) continue;
-
-                const currentPos = pacerPositions[i].position;
-                const lastPos = lastPositions[i];
-
-                // Check if pacer crossed the start/finish line (0m)
-                if (lastPos > trackLength * 0.8 && currentPos < trackLength * 0.2) {
-                    lapCounts[i]++;
-                }
+        // Estimate the controller clock offset from the fastest of a few /time
+        // round trips, so every phone agrees on when a scheduled start happens.
+        // Resolves once the round trips are done.
+        function syncClock() {
+            let bestRtt = null;
+            let samples = 0;
+
+            return new Promise(resolve => {
+                const sample = () => {
+                    const sent = performance.now();
+                    fetch('/time')
+                        .then(response => response.json())
+                        .then(data => {
+                            const received = performance.now();
+                            if (bestRtt === null || received - sent < bestRtt) {
+                                bestRtt = received - sent;
+                                clockOffset = data.now - (sent + received) / 2 * 1000;
+                                clockSynced = true;
+                            }
+                            if (++samples < 8) sample(); else resolve();
+                        })
+                        .catch(() => resolve());
+                };
+                sample();
+            });
+        }
 
-                lastPositions[i] = currentPos;
+        function controllerNow() {
+            return performance.now() * 1000 + clockOffset;
+        }
 
-                // Track fastest lap time
-                const lapTime = parseFloat(document.getElementById(`pace${i+1}Range`).value);
-                if (lapCounts[i] > 0 && (fastestLap === null || lapTime < fastestLap)) {
-                    fastestLap = lapTime;
-                }
+        // Lap crossings are detected on the controller; only fetch new ones
+        function fetchLapEvents(latestSeq) {
+            if (eventCursor === null) {
+                eventCursor = latestSeq;
+                return;
             }
+            if (latestSeq === eventCursor || eventsPending) return;
 
-            if (fastestLap !== null) {
-                document.getElementById('fastestLap').textContent = fastestLap.toFixed(1) + 's';
-            }
+            eventsPending = true;
+            fetch('/events?since=' + eventCursor)
+                .then(response => response.ok ? response.json() : null)
+                .then(data => {
+                    if (!data) return;
+                    if (data.next < eventCursor) {
+                        // Controller restarted; its sequence starts over
+                        eventCursor = data.next;
+                        return;
+                    }
+                    data.events.forEach(e => {
+                        if (!isRunning) return;
+                        lapCounts[e.pacer] = e.lap;
+                        if (!e.partial && (fastestSplit === null || e.split < fastestSplit)) {
+                            fastestSplit = e.split;
+                        }
+                    });
+                    eventCursor = data.next;
+
+                    if (fastestSplit !== null) {
+                        document.getElementById('fastestLap').textContent = (fastestSplit / 1000000).toFixed(1) + 's';
+                    }
+                })
+                .finally(() => { eventsPending = false; });
         }
 
         function createTrackMarkers() {
@@ -1167,19 +1218,31 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
         }
 
         function checkStatus() {
-            fetch('/status')
-                .then(response => response.json())
-                .then(data => {
+            fetch('/status?since=' + statusSeq)
+                .then(response => {
                     updateConnectionStatus(true);
+                    // 304: unchanged since statusSeq; 429: polling too fast
+                    return response.status === 200 ? response.json() : null;
+                })
+                .then(data => {
+                    if (!data) return;
+                    statusSeq = data.seq;
                     if (data.running !== isRunning) {
                         isRunning = data.running;
                         updateButtonStates(isRunning);
                     }
+                    if (data.running && data.startAt !== startTime) {
+                        startTime = data.startAt;
+                        lapCounts = [0, 0, 0];
+                        fastestSplit = null;
+                        document.getElementById('fastestLap').textContent = '-';
+                    }
                     if (data.positions) {
                         pacerPositions = data.positions;
-                        updateLapCounts();
+                        trackMeters = data.trackMeters;
                         updateTrackVisualization();
                     }
+                    fetchLapEvents(data.eventSeq);
                 })
                 .catch(() => updateConnectionStatus(false));
         }
@@ -1191,7 +1254,8 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
 
             if (!pacerPositions || pacerPositions.length === 0) return;
 
-            const trackLength = currentSegments * 5;
+            // Positions are physical meters; calibrated tracks differ from 5m per segment
+            const trackLength = trackMeters || currentSegments * 5;
 
             pacerPositions.forEach((pacer, index) => {
                 if (!pacer.enabled) return;
@@ -1229,6 +1293,7 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
             }
 
             const preset = {
+                name: name,
                 segments: currentSegments,
                 pacers: []
             };
@@ -1245,9 +1310,10 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
             fetch('/preset/save', {
                 method: 'POST',
                 headers: {'Content-Type': 'application/json'},
-                body: JSON.stringify({name: name, data: JSON.stringify(preset)})
+                body: JSON.stringify(preset)
             })
-            .then(() => {
+            .then(response => {
+                if (!response.ok) return response.text().then(text => alert('Preset not saved: ' + text));
                 document.getElementById('presetName').value = '';
                 loadPresetList();
             });
@@ -1398,6 +1464,28 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
             event.target.value = '';
         }
 
+        function importPresetLibrary(event) {
+            const file = event.target.files[0];
+            if (!file) return;
+            if (!confirm(`Replace all saved presets with "${file.name}"?`)) {
+                event.target.value = '';
+                return;
+            }
+
+            // The file goes up as-is; the device parses it as it arrives
+            fetch('/presets/import', {
+                method: 'POST',
+                headers: {'Content-Type': 'application/json'},
+                body: file
+            })
+            .then(response => response.text().then(text => {
+                alert(response.ok ? 'Presets imported' : 'Import failed, presets unchanged\n\n' + text);
+                loadPresetList();
+            }));
+
+            event.target.value = '';
+        }
+
         function loadPresetList() {
             fetch('/preset/list')
                 .then(response => response.json())
@@ -1492,6 +1580,8 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
                 method: 'POST',
                 headers: {'Content-Type': 'text/plain'},
                 body: 'SET:' + segments
+            }).then(response => {
+                if (!response.ok) response.text().then(text => alert('Track length not changed: ' + text));
             });
         }
 
@@ -1500,6 +1590,8 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
             updatePositionButtons();
             loadPresetList();
             createTrackMarkers();
+            syncClock();
+            setInterval(syncClock, 60000);
 
             // Initialize pacer summaries
             for (let i = 1; i <= 3; i++) {
@@ -1534,28 +1626,45 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
             isRunning = true;
             updateButtonStates(true);
 
-            let cmd = 'START:';
-
+            let pacerList = '';
             if (document.getElementById('pace1Enable').checked) {
                 let time = document.getElementById('pace1Range').value;
-                cmd += time + ',' + selectedPositions[0] + ',' + selectedColors[0] + '|';
+                pacerList += time + ',' + selectedPositions[0] + ',' + selectedColors[0] + '|';
             }
 
             if (document.getElementById('pace2Enable').checked) {
                 let time = document.getElementById('pace2Range').value;
-                cmd += time + ',' + selectedPositions[1] + ',' + selectedColors[1] + '|';
+                pacerList += time + ',' + selectedPositions[1] + ',' + selectedColors[1] + '|';
             }
 
             if (document.getElementById('pace3Enable').checked) {
                 let time = document.getElementById('pace3Range').value;
-                cmd += time + ',' + selectedPositions[2] + ',' + selectedColors[2] + '|';
+                pacerList += time + ',' + selectedPositions[2] + ',' + selectedColors[2] + '|';
             }
 
-            fetch('/command', {
+            // Schedule the start a few seconds out so every pacer is armed
+            // before it; fall back to an immediate start until the clock is synced
+            const startCommand = () => clockSynced
+                ? 'START_AT:' + Math.round(controllerNow() + START_LEAD_MS * 1000) + ':' + pacerList
+                : 'START:' + pacerList;
+            const send = cmd => fetch('/command', {
                 method: 'POST',
                 headers: {'Content-Type': 'text/plain'},
                 body: cmd
             });
+
+            // A rejected start time means the clock estimate is stale (the
+            // controller rebooted, say): resync and try once more
+            send(startCommand())
+                .then(response => response.ok ? response : syncClock().then(() => send(startCommand())))
+                .then(response => {
+                    if (!response.ok) return response.text().then(text => { throw new Error(text); });
+                })
+                .catch(err => {
+                    isRunning = false;
+                    updateButtonStates(false);
+                    alert('Pacers not started: ' + err.message);
+                });
         };
 
         document.getElementById('stopBtn').onclick = function() {
@@ -1,27 +1,112 @@
 #ifndef WEB_SERVER_H
 #define WEB_SERVER_H
 
-#include <WebServer.h>
 #include <Preferences.h>
 #include "config.h"
+#include "request_server.h"
+#include "arena.h"
 #include "pacer.h"
+#include "events.h"
+#include "sync.h"
+#include "session_store.h"
+#include "session_log.h"
+#include "led_control.h"
+#include "rate_limit.h"
+#include "sacn.h"
+#include "presets.h"
+#include "power.h"
 #include "web_page.h"
 
 // Global variables (extern means defined in main .ino file)
-extern WebServer server;
+extern RequestServer server;
 extern Preferences preferences;
 extern bool systemRunning;
+extern clock_us_t sessionStartTime;
+extern clock_us_t firstFrameTime;
 extern int connectedClients;
 extern int TOTAL_SEGMENTS;
 
+bool hasRequestArg(const char *name) {
+  return server.findArg(name) != NULL;
+}
+
+// Request argument, copied into the request arena (empty if missing)
+StrView requestArg(const char *name) {
+  const String *value = server.findArg(name);
+  if (!value) return StrView{"", 0};
+  return arenaCopy(value->c_str(), value->length());
+}
+
+// Send a response built in a TextWriter straight from its buffer
+void sendText(int code, const char *contentType, const TextWriter &out) {
+  if (out.overflow) {
+    server.send(500, "text/plain", "Response too large");
+    return;
+  }
+  server.send_P(code, contentType, out.buf, out.len);
+}
+
+// Send one chunk of a chunked response written at mark, then hand its
+// space back for the next. The status line has already gone, so a chunk
+// that did not fit cannot become an error response: the connection is
+// dropped instead, and the client sees a failed download rather than a
+// truncated file. False then; send nothing more.
+bool sendChunk(const TextWriter &chunk, size_t mark) {
+  arenaClose(chunk);
+  if (chunk.overflow) {
+    server.client().stop();
+    arenaRelease(mark);
+    return false;
+  }
+  server.sendContent(chunk.buf, chunk.len);
+  arenaRelease(mark);
+  return true;
+}
+
 // Serve the main HTML page
 void handleRoot() {
-  server.send(200, "text/html", HTML_PAGE);
+  server.send_P(200, "text/html", HTML_PAGE);
 }
 
-// Handle system status requests (for live updates)
-void handleStatus() {
-  String json = "{\"running\":";
+// True if the request carries header name with exactly value
+bool requestHeaderIs(const char *name, const char *value) {
+  const String *header = server.findHeader(name);
+  return header && strcmp(header->c_str(), value) == 0;
+}
+
+// Status snapshot
+// Every connected phone polls /status. The payload is built once per change
+// of the state it reports and the same bytes are served to every client, so
+// serialization cost does not grow with the number of clients. Each build
+// gets a new sequence number, sent as the ETag and as "seq"; a client that
+// already has the current one (If-None-Match or ?since=<seq>) gets an empty
+// 304. The frame and poll counters are as of the last build.
+char statusJson[STATUS_JSON_SIZE];
+size_t statusLength = 0;
+uint32_t statusSeq = 0;
+
+struct StatusKey {
+  uint32_t frameGeneration;
+  uint32_t configGen;
+  uint32_t eventSeq;
+  int clients;
+  bool running;
+  float trackMeters;
+};
+
+StatusKey statusKey;
+
+bool statusKeyChanged(const StatusKey &key) {
+  return key.frameGeneration != statusKey.frameGeneration || key.configGen != statusKey.configGen ||
+         key.eventSeq != statusKey.eventSeq || key.clients != statusKey.clients ||
+         key.running != statusKey.running || key.trackMeters != statusKey.trackMeters;
+}
+
+void buildStatus() {
+  TextWriter json = textWriter(statusJson, sizeof(statusJson));
+  json += "{\"seq\":";
+  json += statusSeq;
+  json += ",\"running\":";
   json += systemRunning ? "true" : "false";
   json += ",\"clients\":";
   json += connectedClients;
@@ -31,8 +116,11 @@ void handleStatus() {
     if (i > 0) json += ",";
     json += "{\"enabled\":";
     json += pacers[i].enabled ? "true" : "false";
+    json += ",\"lane\":";
+    json += pacers[i].lane;
     json += ",\"position\":";
-    json += String(pacers[i].currentPosition * 5.0 / LOGICAL_UNITS_PER_SEGMENT, 2);
+    int slot = pacerHot.slotOf[i];
+    json.appendFixed(slot >= 0 ? pacerHot.phase[slot] * trackMeters / 65536 : 0, 2);
     json += ",\"color\":\"";
     char colorHex[8];
     sprintf(colorHex, "#%02X%02X%02X", pacers[i].color.r, pacers[i].color.g, pacers[i].color.b);
@@ -40,47 +128,275 @@ void handleStatus() {
     json += "\"}";
   }
 
+  json += "],\"trackMeters\":";
+  json.appendFixed(trackMeters, 2);
+  json += ",\"startAt\":";
+  json += (unsigned long long)sessionStartTime;
+  json += ",\"bootMs\":";
+  json += (unsigned long)(firstFrameTime / CLOCK_US_PER_MS);
+  json += ",\"eventSeq\":";
+  json += latestLapEventSeq();
+  json += ",\"framesShown\":";
+  json += framesShown;
+  json += ",\"framesSkipped\":";
+  json += framesSkipped;
+  json += ",\"pollsRejected\":";
+  json += pollsRejected;
+  json += ",\"sacnUniversesSent\":";
+  json += sacnUniversesSent;
+  json += ",\"arenaPeak\":";
+  json += (unsigned long)arenaPeak;
+  json += ",\"arenaOverflows\":";
+  json += arenaOverflows;
+  json += ",\"heapFree\":";
+  json += ESP.getFreeHeap();
+  json += ",\"heapMin\":";
+  json += ESP.getMinFreeHeap();
+  json += ",\"idle\":";
+  json += powerIdle ? "true" : "false";
+  json += ",\"wakeLatencyUs\":";
+  json += wakeLatencyUs;
+  json += ",\"wakeLatencyMaxUs\":";
+  json += wakeLatencyMaxUs;
+  json += "}";
+  statusLength = json.len;
+}
+
+// Handle system status requests (for live updates)
+void handleStatus() {
+  if (!admitPoll()) return;
+
+  StatusKey key = {frameGeneration, syncConfigGen, latestLapEventSeq(), connectedClients, systemRunning, trackMeters};
+
+  if (statusSeq == 0 || statusKeyChanged(key)) {
+    statusKey = key;
+    statusSeq++;
+    buildStatus();
+  }
+
+  char etag[16];
+  snprintf(etag, sizeof(etag), "\"%lu\"", (unsigned long)statusSeq);
+  server.sendHeader("ETag", etag);
+  server.sendHeader("Cache-Control", "no-cache");
+
+  if (requestHeaderIs("If-None-Match", etag) ||
+      (hasRequestArg("since") && requestArg("since").toU64() == statusSeq)) {
+    server.send(304, "text/plain", "");
+    return;
+  }
+
+  server.send_P(200, "application/json", statusJson, statusLength);
+}
+
+// Report the pacing clock so clients can estimate their offset to it
+void handleTime() {
+  TextWriter json = arenaWriter();
+  json += "{\"now\":";
+  json += (unsigned long long)trackMicros();
+  json += "}";
+  arenaClose(json);
+  sendText(200, "application/json", json);
+}
+
+// Handle lap event requests: returns events newer than ?since=<seq>
+void handleEvents() {
+  if (!admitPoll()) return;
+
+  uint32_t since = requestArg("since").toU64();
+  uint32_t head = latestLapEventSeq();
+
+  uint32_t first = since + 1;
+  if (head >= EVENT_RING_SIZE && first <= head - EVENT_RING_SIZE) {
+    first = head - EVENT_RING_SIZE + 1;
+  }
+
+  TextWriter json = arenaWriter();
+  json += "{\"next\":";
+  json += head;
+  json += ",\"dropped\":";
+  json += first > since + 1 ? "true" : "false";
+  json += ",\"events\":[";
+
+  bool firstEvent = true;
+  LapEvent e;
+  for (uint32_t seq = first; seq <= head; seq++) {
+    if (!readLapEvent(seq, e)) continue;
+
+    if (!firstEvent) json += ",";
+    json += "{\"seq\":";
+    json += e.seq;
+    json += ",\"pacer\":";
+    json += e.pacer;
+    json += ",\"lap\":";
+    json += e.lap;
+    json += ",\"t\":";
+    json += (unsigned long long)e.timestamp;
+    json += ",\"split\":";
+    json += e.splitMicros;
+    json += ",\"partial\":";
+    json += (e.flags & LAP_EVENT_PARTIAL) ? "true" : "false";
+    json += "}";
+    firstEvent = false;
+  }
+
   json += "]}";
-  server.send(200, "application/json", json);
+  arenaClose(json);
+  sendText(200, "application/json", json);
 }
 
-// Handle save preset request
-void handleSavePreset() {
-  if (server.hasArg("plain")) {
-    String body = server.arg("plain");
+// Handle ghost upload: /ghost/save?slot=<n>&name=<name>&split=<meters>
+// with the split times in seconds as a comma-separated body
+void handleSaveGhost() {
+  int slot = requestArg("slot").toInt();
+  float splitMeters = requestArg("split").toFloat();
+  GhostTable table;
+
+  if (!hasRequestArg("slot") || slot < 0 || slot >= MAX_GHOSTS ||
+      splitMeters < 1 || splitMeters > 6500 || !hasRequestArg("plain")) {
+    server.send(400, "text/plain", "Bad ghost");
+    return;
+  }
 
-    int nameStart = body.indexOf("\"name\":\"") + 8;
-    int nameEnd = body.indexOf("\"", nameStart);
-    String name = body.substring(nameStart, nameEnd);
+  if (!parseGhostSplits(requestArg("plain"), table)) {
+    server.send(400, "text/plain", "Bad splits");
+    return;
+  }
 
-    int dataStart = body.indexOf("\"data\":\"") + 8;
-    int dataEnd = body.lastIndexOf("\"");
-    String data = body.substring(dataStart, dataEnd);
+  memset(table.name, 0, sizeof(table.name));
+  requestArg("name").copyTo(table.name, GHOST_NAME_LEN);
+  table.splitDecimeters = (uint16_t)(splitMeters * 10 + 0.5);
+  saveGhost(slot, table);
 
-    data.replace("\\\"", "\"");
+  Serial.print("Saved ghost: ");
+  Serial.println(table.name);
+  server.send(200, "text/plain", "OK");
+}
 
-    String key = "preset_" + name;
-    preferences.putString(key.c_str(), data);
+// Handle ghost download: /ghost/load?slot=<n>
+void handleLoadGhost() {
+  GhostTable table;
 
-    Serial.println("Saved preset: " + name);
-    server.send(200, "text/plain", "OK");
+  if (!loadGhost(requestArg("slot").toInt(), table) || !hasRequestArg("slot")) {
+    server.send(404, "text/plain", "Ghost not found");
+    return;
+  }
+
+  TextWriter json = arenaWriter();
+  json += "{\"name\":";
+  json.appendQuoted(table.name);
+  json += ",\"split\":";
+  json.appendFixed(table.splitDecimeters / 10.0, 1);
+  json += ",\"splits\":[";
+
+  for (int j = 0; j < table.count; j++) {
+    if (j > 0) json += ",";
+    json.appendFixed(table.splitCentis[j] / 100.0, 2);
+  }
+
+  json += "]}";
+  arenaClose(json);
+  sendText(200, "application/json", json);
+}
+
+// Handle ghost list request: name of each used slot
+void handleListGhosts() {
+  TextWriter json = arenaWriter();
+  json += "[";
+  bool first = true;
+  GhostTable table;
+
+  for (int slot = 0; slot < MAX_GHOSTS; slot++) {
+    if (!loadGhost(slot, table)) continue;
+
+    if (!first) json += ",";
+    json += "{\"slot\":";
+    json += slot;
+    json += ",\"name\":";
+    json.appendQuoted(table.name);
+    json += "}";
+    first = false;
+  }
+
+  json += "]";
+  arenaClose(json);
+  sendText(200, "application/json", json);
+}
+
+// Preset uploads are parsed as the body arrives; see presets.h
+JsonStream presetJson;
+PresetParse presetUpload;
+bool presetUploadStarted = false;
+
+// Reply 400 with why a parse stopped and where
+void sendParseError(const JsonStream &json) {
+  TextWriter message = arenaWriter();
+  message += json.error;
+  message += " at byte ";
+  message += (unsigned long)json.position;
+  arenaClose(message);
+  sendText(400, "text/plain", message);
+}
+
+// Receive a preset body in chunks
+void handlePresetUpload() {
+  HTTPRaw &raw = server.raw();
+
+  if (raw.status == RAW_START) {
+    jsonBegin(presetJson, presetDocumentEvent, &presetUpload);
+    beginPresetParse(presetUpload, 1);
+    presetUploadStarted = true;
+  } else if (raw.status == RAW_WRITE) {
+    jsonFeed(presetJson, (const char*)raw.buf, raw.currentSize);
+  } else if (raw.status == RAW_END) {
+    if (jsonFinish(presetJson)) {
+      const char *error = presetParseError(presetUpload);
+      if (error) jsonFail(presetJson, error);
+    }
   } else {
+    jsonFail(presetJson, "Upload aborted");
+  }
+}
+
+// Handle save preset request, once the body has been parsed
+void handleSavePreset() {
+  if (!presetUploadStarted) {
     server.send(400, "text/plain", "No data");
+    return;
   }
+  presetUploadStarted = false;
+
+  if (presetJson.error) {
+    sendParseError(presetJson);
+    return;
+  }
+
+  if (!storePreset(presetUpload.record)) {
+    server.send(507, "text/plain", "Preset storage full");
+    return;
+  }
+
+  Serial.print("Saved preset: ");
+  Serial.println(presetUpload.record.name);
+  server.send(200, "text/plain", "OK");
 }
 
 // Handle load preset request
 void handleLoadPreset() {
-  if (server.hasArg("name")) {
-    String name = server.arg("name");
-    String key = "preset_" + name;
-    String data = preferences.getString(key.c_str(), "");
+  if (hasRequestArg("name")) {
+    char name[PRESET_NAME_LEN];
+    requestArg("name").copyTo(name, sizeof(name));
 
-    if (data.length() > 0) {
-      server.send(200, "application/json", data);
-    } else {
+    PresetRecord record;
+    int slot = findPreset(name);
+    if (slot < 0 || !loadPresetSlot(slot, record)) {
       server.send(404, "text/plain", "Preset not found");
+      return;
     }
+
+    TextWriter json = arenaWriter();
+    appendPresetJson(json, record);
+    arenaClose(json);
+    sendText(200, "application/json", json);
   } else {
     server.send(400, "text/plain", "No name provided");
   }
@@ -88,57 +404,130 @@ void handleLoadPreset() {
 
 // Handle list presets request
 void handleListPresets() {
-  String json = "[";
+  TextWriter json = arenaWriter();
+  json += "[";
   bool first = true;
+  PresetRecord record;
 
-  preferences.begin("trackpacer", true);
+  for (int slot = 0; slot < MAX_PRESETS; slot++) {
+    if (!loadPresetSlot(slot, record)) continue;
 
-  for (int i = 0; i < 20; i++) {
-    String key = "preset_" + String(i);
-    if (preferences.isKey(key.c_str())) {
-      if (!first) json += ",";
-      String name = key.substring(7);
-      json += "\"" + name + "\"";
-      first = false;
-    }
+    if (!first) json += ",";
+    json.appendQuoted(record.name);
+    first = false;
   }
 
-  preferences.end();
-  preferences.begin("trackpacer", false);
-
   json += "]";
-  server.send(200, "application/json", json);
+  arenaClose(json);
+  sendText(200, "application/json", json);
 }
 
 // Handle delete preset request
 void handleDeletePreset() {
-  if (server.hasArg("plain")) {
-    String name = server.arg("plain");
-    String key = "preset_" + name;
-    preferences.remove(key.c_str());
+  if (hasRequestArg("plain")) {
+    char name[PRESET_NAME_LEN];
+    requestArg("plain").copyTo(name, sizeof(name));
+
+    if (!deletePreset(name)) {
+      server.send(404, "text/plain", "Preset not found");
+      return;
+    }
 
-    Serial.println("Deleted preset: " + name);
+    Serial.print("Deleted preset: ");
+    Serial.println(name);
     server.send(200, "text/plain", "OK");
   } else {
     server.send(400, "text/plain", "No data");
   }
 }
 
-// Handle segment count updates
+// Receive a preset library body in chunks, writing each preset as it is
+// parsed
+PresetImport presetImport;
+
+void handleLibraryUpload() {
+  HTTPRaw &raw = server.raw();
+
+  if (raw.status == RAW_START) {
+    jsonBegin(presetJson, presetLibraryEvent, &presetImport);
+    beginPresetImport(presetImport);
+    presetUploadStarted = true;
+  } else if (raw.status == RAW_WRITE) {
+    jsonFeed(presetJson, (const char*)raw.buf, raw.currentSize);
+  } else if (raw.status == RAW_END) {
+    jsonFinish(presetJson);
+  } else {
+    jsonFail(presetJson, "Upload aborted");
+  }
+}
+
+// Handle library import: replaces every preset, or none if the upload fails
+void handleImportPresets() {
+  if (!presetUploadStarted) {
+    server.send(400, "text/plain", "No data");
+    return;
+  }
+  presetUploadStarted = false;
+
+  if (presetJson.error) {
+    sendParseError(presetJson);
+    return;
+  }
+
+  commitPresetImport(presetImport);
+
+  Serial.print("Imported presets: ");
+  Serial.println(presetImport.count);
+  server.send(200, "text/plain", "OK");
+}
+
+// Export every preset as one JSON array, a preset per chunk
+void handleExportPresets() {
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.sendHeader("Content-Disposition", "attachment; filename=\"track_pacer_presets.json\"");
+  server.send(200, "application/json", "[");
+
+  bool first = true;
+  PresetRecord record;
+
+  for (int slot = 0; slot < MAX_PRESETS; slot++) {
+    if (!loadPresetSlot(slot, record)) continue;
+
+    size_t mark = arenaUsed;
+    TextWriter chunk = arenaWriter();
+    if (!first) chunk += ",";
+    appendPresetJson(chunk, record);
+    if (!sendChunk(chunk, mark)) return;
+    first = false;
+  }
+
+  server.sendContent("]");
+  server.sendContent("");
+}
+
+// Handle segment count updates. Running pacers carry on (see
+// activatePacers); the change lands between two frames, and the new frame
+// is drawn over the rebuilt background in the same loop pass.
 void handleSegments() {
-    if (server.hasArg("plain")) {
-        String command = server.arg("plain");
+    if (hasRequestArg("plain")) {
+        StrView command = requestArg("plain");
 
         if (command.startsWith("SET:")) {
-            int newSegments = command.substring(4).toInt();
+            int newSegments = command.sub(4).toInt();
+
+            if (newSegments != TOTAL_SEGMENTS && ghostRunning()) {
+                server.send(409, "text/plain", "Stop the ghost pacers before changing the track length");
+                return;
+            }
 
-            if (newSegments >= 1 && newSegments <= 80) {
+            if (newSegments >= 1 && newSegments <= MAX_SEGMENTS) {
                 TOTAL_SEGMENTS = newSegments;
                 current_NUM_LEDS = TOTAL_SEGMENTS * LOGICAL_UNITS_PER_SEGMENT;
-
-                systemRunning = false;
-                FastLED.clear();
-                FastLED.show();
+                buildCalibration();
+                activatePacers(false);
+                buildBackground();
+                syncConfigChanged();
+                saveSession();
 
                 Serial.print("Segments set to: ");
                 Serial.println(TOTAL_SEGMENTS);
@@ -152,24 +541,235 @@ void handleSegments() {
     }
 }
 
+// Report the measured length of each active segment in meters
+void handleGetCalibration() {
+  TextWriter json = arenaWriter();
+  json += "{\"trackMeters\":";
+  json.appendFixed(trackMeters, 2);
+  json += ",\"segments\":[";
+
+  for (int k = 0; k < TOTAL_SEGMENTS; k++) {
+    if (k > 0) json += ",";
+    json.appendFixed(segmentMeters[k], 3);
+  }
+
+  json += "]}";
+  arenaClose(json);
+  sendText(200, "application/json", json);
+}
+
+// Handle calibration updates: CAL:<meters>,<meters>,... starting at segment 0
+void handleSetCalibration() {
+  if (hasRequestArg("plain")) {
+    StrView command = requestArg("plain");
+
+    if (!command.startsWith("CAL:")) {
+      server.send(400, "text/plain", "Bad command");
+      return;
+    }
+    if (ghostRunning()) {
+      server.send(409, "text/plain", "Stop the ghost pacers before changing the track length");
+      return;
+    }
+
+    float measured[MAX_SEGMENTS];
+    int count = 0;
+    int lastPos = 4;
+
+    while (lastPos <= command.len && count < MAX_SEGMENTS) {
+      int comma = command.indexOf(',', lastPos);
+      if (comma == -1) comma = command.len;
+
+      float meters = command.sub(lastPos, comma).toFloat();
+      if (meters < 0.5 || meters > 20.0) {
+        server.send(400, "text/plain", "Segment length out of range");
+        return;
+      }
+      measured[count++] = segmentLength(meters);
+      lastPos = comma + 1;
+    }
+
+    for (int k = 0; k < count; k++) {
+      segmentMeters[k] = measured[k];
+    }
+    saveCalibration();
+    buildCalibration();
+    activatePacers(false);
+    buildBackground();
+    syncConfigChanged();
+    saveSession();
+
+    Serial.print("Calibrated track length: ");
+    Serial.println(trackMeters);
+    server.send(200, "text/plain", "OK");
+  } else {
+    server.send(400, "text/plain", "No data");
+  }
+}
+
+// Report each lane's geometry
+void handleGetLanes() {
+  TextWriter json = arenaWriter();
+  json += "[";
+
+  for (int l = 0; l < NUM_LANES; l++) {
+    if (l > 0) json += ",";
+    json += "{\"extra\":";
+    json.appendFixed(lanes[l].extraMeters, 2);
+    json += ",\"stagger\":";
+    json.appendFixed(lanes[l].staggerMeters, 2);
+    json += "}";
+  }
+
+  json += "]";
+  arenaClose(json);
+  sendText(200, "application/json", json);
+}
+
+// Handle lane geometry updates: LANE:<lane>,<extra meters>,<stagger meters>
+void handleSetLane() {
+  if (hasRequestArg("plain")) {
+    StrView command = requestArg("plain");
+    int comma1 = command.indexOf(',');
+    int comma2 = command.indexOf(',', comma1 + 1);
+
+    if (!command.startsWith("LANE:") || comma1 == -1 || comma2 == -1) {
+      server.send(400, "text/plain", "Bad command");
+      return;
+    }
+
+    int lane = command.sub(5, comma1).toInt();
+    if (lane < 0 || lane >= NUM_LANES) {
+      server.send(400, "text/plain", "No such lane");
+      return;
+    }
+
+    // A lane is no shorter than lane 1, and its stagger lies within its lap
+    float extra = command.sub(comma1 + 1, comma2).toFloat();
+    float stagger = command.sub(comma2 + 1).toFloat();
+    if (!isfinite(extra) || extra < 0 || !isfinite(stagger) || stagger < 0 || stagger >= trackMeters + extra) {
+      server.send(400, "text/plain", "Lane geometry out of range");
+      return;
+    }
+
+    lanes[lane].extraMeters = extra;
+    lanes[lane].staggerMeters = stagger;
+    saveLanes();
+    activatePacers(false);
+    buildBackground();
+    syncConfigChanged();
+    saveSession();
+
+    server.send(200, "text/plain", "OK");
+  } else {
+    server.send(400, "text/plain", "No data");
+  }
+}
+
 // Handle start/stop commands
 void handleCommand() {
-  if (server.hasArg("plain")) {
-    String command = server.arg("plain");
+  if (hasRequestArg("plain")) {
+    StrView command = requestArg("plain");
 
     if (command.startsWith("START:")) {
-      parseStartCommand(command);
+      if (!startGhostsExist(command.sub(6))) {
+        server.send(400, "text/plain", "No such ghost");
+        return;
+      }
+      if (!startPositionsValid(command.sub(6))) {
+        server.send(400, "text/plain", "Start position off the track");
+        return;
+      }
+
+      sessionStartTime = trackMicros();
       systemRunning = true;
-    } else if (command == "STOP") {
+      resetFrame();
+      parseStartCommand(command.sub(6), sessionStartTime);
+      logSessionStart();
+    } else if (command.startsWith("START_AT:")) {
+      // START_AT:<clock micros>:<pacer list>, scheduled against /time
+      int sep = command.indexOf(':', 9);
+      clock_us_t startAt = command.sub(9, sep).toU64();
+      clock_us_t now = trackMicros();
+
+      // A start a little in the past is one that spent a while in flight;
+      // more than that (or 0) is a page whose clock estimate is stale
+      if (sep == -1 || startAt == 0 || startAt > now + MAX_START_DELAY_MS * CLOCK_US_PER_MS ||
+          startAt + MAX_START_LATE_MS * CLOCK_US_PER_MS < now) {
+        server.send(400, "text/plain", "Bad start time");
+        return;
+      }
+      if (!startGhostsExist(command.sub(sep + 1))) {
+        server.send(400, "text/plain", "No such ghost");
+        return;
+      }
+      if (!startPositionsValid(command.sub(sep + 1))) {
+        server.send(400, "text/plain", "Start position off the track");
+        return;
+      }
+
+      sessionStartTime = startAt;
+      systemRunning = true;
+      resetFrame();
+      parseStartCommand(command.sub(sep + 1), sessionStartTime);
+      logSessionStart();
+    } else if (command.equals("STOP")) {
       systemRunning = false;
-      FastLED.clear();
-      FastLED.show();
+      resetFrame();
+      logSessionStop();
     }
 
+    syncConfigChanged();
+    saveSession();
     server.send(200, "text/plain", "OK");
   } else {
     server.send(400, "text/plain", "No data");
   }
 }
 
+// Stream one log file as CSV, a page of records at a time; false if the
+// response had to be abandoned
+bool sendLogCsv(const char *path) {
+  File file = LittleFS.open(path, FILE_READ);
+  if (!file) return true;
+
+  LogRecord page[LOG_PAGE_RECORDS];
+  size_t count;
+  while ((count = file.read((uint8_t*)page, sizeof(page)) / sizeof(LogRecord)) > 0) {
+    size_t mark = arenaUsed;
+    TextWriter chunk = arenaWriter();
+    for (size_t k = 0; k < count; k++) {
+      appendLogCsv(chunk, page[k]);
+    }
+    if (!sendChunk(chunk, mark)) {
+      file.close();
+      return false;
+    }
+  }
+  file.close();
+  return true;
+}
+
+// Export the session log as CSV, oldest records first. The response is
+// chunked and converted as it is read, so the log never has to fit in RAM.
+void handleExportLog() {
+  flushLog();
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.sendHeader("Content-Disposition", "attachment; filename=\"session.csv\"");
+  server.send(200, "text/csv", "time_s,event,pacer,lap,split_s,lap_time_s,start_m,segments\n");
+
+  if (LittleFS.exists(LOG_OLD_PATH) && !sendLogCsv(LOG_OLD_PATH)) return;
+  if (LittleFS.exists(LOG_PATH) && !sendLogCsv(LOG_PATH)) return;
+  server.sendContent("");
+}
+
+// Delete the session log
+void handleClearLog() {
+  logStaged = 0;
+  LittleFS.remove(LOG_OLD_PATH);
+  LittleFS.remove(LOG_PATH);
+  server.send(200, "text/plain", "OK");
+}
+
 #endif